@@ -27,6 +27,7 @@
  * SUCH DAMAGE.
  */
 #include <stdint.h>
+#include <string.h>
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -53,6 +54,29 @@ struct mh_i32ptr_node_t {
 #define mh_eq_key(a, b, arg) ((a) == (b->key))
 #include "salad/mhash.h"
 
+/*
+ * Map: (char * with length) => (void *)
+ * The string is not copied and must outlive the node,
+ * its hash is calculated by the caller.
+ */
+#define mh_name _strnptr
+struct mh_strnptr_node_t {
+	const char *str;
+	uint32_t len;
+	uint32_t hash;
+	void *val;
+};
+
+#define mh_key_t const struct mh_strnptr_node_t *
+#define mh_node_t struct mh_strnptr_node_t
+#define mh_arg_t void *
+#define mh_hash(a, arg) ((a)->hash)
+#define mh_hash_key(a, arg) ((a)->hash)
+#define mh_eq(a, b, arg) ((a)->len == (b)->len && \
+			  memcmp((a)->str, (b)->str, (a)->len) == 0)
+#define mh_eq_key(a, b, arg) mh_eq(a, b, arg)
+#include "salad/mhash.h"
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
@@ -41,6 +41,7 @@
 #include <ctype.h>
 #include "cluster.h" /* for cluster_set_uuid() */
 #include "session.h" /* to fetch the current user. */
+#include "memtx_engine.h" /* for memtx_checkpoint_copy_space() */
 
 /** _space columns */
 #define ID               0
@@ -337,6 +338,8 @@ alter_space_commit(struct trigger *trigger, void * /* event */)
 	 */
 	rlist_swap(&alter->new_space->on_replace,
 		   &alter->old_space->on_replace);
+	/* Nor about the statistics collected so far. */
+	alter->new_space->latency = alter->old_space->latency;
 	/*
 	 * The new space is ready. Time to update the space
 	 * cache with it.
@@ -371,6 +374,9 @@ alter_space_rollback(struct trigger *trigger, void * /* event */)
 	alter_space_delete(alter);
 }
 
+static struct index_build *
+index_build_find_space(uint32_t space_id);
+
 /**
  * alter_space_do() - do all the work necessary to
  * create a new space.
@@ -425,6 +431,21 @@ alter_space_do(struct txn *txn, struct alter_space *alter,
 	if (space->on_replace == space_alter_on_replace)
 		tnt_raise(ER_ALTER_SPACE, space_name(space));
 #endif
+	/*
+	 * An index of the space is being built, and the
+	 * build has yielded: the space can't be altered
+	 * concurrently.
+	 */
+	if (index_build_find_space(space_id(old_space)) != NULL) {
+		tnt_raise(ClientError, ER_ALTER_SPACE,
+			  space_name(old_space),
+			  "an index is being built");
+	}
+	/*
+	 * A checkpoint copying the space in portions has
+	 * to finish with the old definition.
+	 */
+	memtx_checkpoint_copy_space(old_space);
 	alter->old_space = old_space;
 	alter->space_def = old_space->def;
 	/* Create a definition of the new space. */
@@ -608,10 +629,24 @@ DropIndex::commit(struct alter_space *alter)
 {
 	/*
 	 * Delete all tuples in the old space if dropping the
-	 * primary key.
+	 * primary key. A secondary key is passed to the engine
+	 * too, in case it keeps the key data apart from the
+	 * tuples.
 	 */
-	if (space_index(alter->new_space, 0) != NULL)
+	if (space_index(alter->new_space, 0) != NULL) {
+		/*
+		 * The index is rebuilt with new parts or
+		 * uniqueness: the new one takes over the data
+		 * kept by the engine under the same index id.
+		 */
+		if (space_index(alter->new_space, old_key_def->iid) != NULL)
+			return;
+		Index *index = space_index(alter->old_space,
+					   old_key_def->iid);
+		if (index != NULL)
+			alter->old_space->handler->engine->dropIndex(index);
 		return;
+	}
 	Index *pk = index_find(alter->old_space, 0);
 	if (pk == NULL)
 		return;
@@ -668,6 +703,62 @@ ModifyIndex::~ModifyIndex()
  * The trigger is removed when alter operation commits/rolls back.
  */
 
+enum {
+	/**
+	 * Number of tuples added to a new index between yields
+	 * of the build, to not block the event loop for long.
+	 */
+	ADD_INDEX_BUILD_YIELD = 1000,
+};
+
+/**
+ * A new index being filled with tuples of the old space.
+ * The build yields from time to time, and the old space may
+ * be changed while it is yielding. Changes of the tuples
+ * which the scan has passed are applied to the new index by
+ * on_replace_in_old_space(), the rest are picked up by the
+ * scan.
+ */
+struct index_build {
+	struct rlist link;
+	/** The index being built. */
+	Index *index;
+	/** The primary key of the old space being scanned. */
+	Index *pk;
+	/** The last tuple added by the scan, NULL if none. */
+	struct tuple *last;
+};
+
+/** Indexes being built, see struct index_build. */
+static RLIST_HEAD(index_builds);
+
+static struct index_build *
+index_build_find_space(uint32_t space_id)
+{
+	struct index_build *build;
+	rlist_foreach_entry(build, &index_builds, link) {
+		if (build->index->key_def->space_id == space_id)
+			return build;
+	}
+	return NULL;
+}
+
+/**
+ * True if a change of a tuple with the same primary key
+ * as the given one has to be applied to the new index,
+ * i.e. the build is done or the scan has passed the key.
+ */
+static bool
+index_build_has_passed(Index *index, struct tuple *tuple)
+{
+	struct index_build *build =
+		index_build_find_space(index->key_def->space_id);
+	if (build == NULL || build->index != index)
+		return true;
+	return build->last != NULL &&
+		tuple_compare(tuple, build->last, build->pk->key_def) <= 0;
+}
+
 /** AddIndex - add a new index to the space. */
 class AddIndex: public AlterSpaceOp {
 public:
@@ -740,6 +831,11 @@ on_rollback_in_old_space(struct trigger *trigger, void *event)
 	rlist_foreach_entry(stmt, &txn->stmts, next) {
 		if (stmt->space->def.id != new_index->key_def->space_id)
 			continue;
+		struct tuple *tuple = stmt->new_tuple ?
+			stmt->new_tuple : stmt->old_tuple;
+		if (tuple == NULL ||
+		    ! index_build_has_passed(new_index, tuple))
+			continue;
 		new_index->replace(stmt->new_tuple, stmt->old_tuple,
 				   DUP_INSERT);
 	}
@@ -767,7 +863,14 @@ on_replace_in_old_space(struct trigger *trigger, void *event)
 	 * on_rollback trigger.
 	 */
 	trigger_add_unique(&txn->on_rollback, on_rollback);
-	/* Put the tuple into the new index. */
+	/*
+	 * Put the tuple into the new index, unless the build
+	 * hasn't reached it yet: then the scan will add it.
+	 */
+	struct tuple *tuple = stmt->new_tuple ?
+		stmt->new_tuple : stmt->old_tuple;
+	if (! index_build_has_passed(new_index, tuple))
+		return;
 	(void) new_index->replace(stmt->old_tuple, stmt->new_tuple,
 				  DUP_INSERT);
 }
@@ -845,8 +948,6 @@ AddIndex::alter(struct alter_space *alter)
 		return;
 	}
 	/* Now deal with any kind of add index during normal operation. */
-	struct iterator *it = pk->position();
-	pk->initIterator(it, ITER_ALL, NULL, 0);
 	/*
 	 * The index has to be built tuple by tuple, since
 	 * there is no guarantee that all tuples satisfy
@@ -856,12 +957,46 @@ AddIndex::alter(struct alter_space *alter)
 	 */
 	new_index->beginBuild();
 	new_index->endBuild();
+	/*
+	 * Keep the new index up to date with changes made
+	 * while the build is yielding, and afterwards, while
+	 * the alter is being written to the WAL.
+	 */
+	on_replace = txn_alter_trigger_new(on_replace_in_old_space,
+					   new_index);
+	trigger_add(&alter->old_space->on_replace, on_replace);
+
+	struct index_build build;
+	build.index = new_index;
+	build.pk = pk;
+	build.last = NULL;
+	rlist_add_entry(&index_builds, &build, link);
+	/*
+	 * A private iterator: the pre-allocated one may be
+	 * used by other fibers while the build yields.
+	 */
+	struct iterator *it = pk->allocIterator();
+	/* The tuple the scan resumes after, referenced. */
+	struct tuple *held = NULL;
+	auto build_guard = make_scoped_guard([&]{
+		it->free(it);
+		if (held != NULL)
+			tuple_unref(held);
+		rlist_del_entry(&build, link);
+	});
+	pk->initIterator(it, ITER_ALL, NULL, 0);
+	/*
+	 * Only a TREE primary key can resume the scan after
+	 * a yield. Otherwise the index is built in one go.
+	 */
+	bool can_yield = pk->key_def->type == TREE;
 	/* Build the new index. */
 	struct tuple *tuple;
 	struct tuple_format *format = alter->new_space->format;
 	char *field_map = ((char *) region_alloc(&fiber()->gc,
 						 format->field_map_size) +
 			   format->field_map_size);
+	uint32_t count = 0;
 	while ((tuple = it->next(it))) {
 		/*
 		 * Check that the tuple is OK according to the
@@ -875,10 +1010,21 @@ AddIndex::alter(struct alter_space *alter)
 			new_index->replace(NULL, tuple, DUP_INSERT);
 		assert(old_tuple == NULL); /* Guaranteed by DUP_INSERT. */
 		(void) old_tuple;
+		build.last = tuple;
+		if (! can_yield || ++count % ADD_INDEX_BUILD_YIELD != 0)
+			continue;
+		/*
+		 * Let other fibers run. The last added tuple
+		 * may be deleted meanwhile, keep it around to
+		 * find the scan position.
+		 */
+		tuple_ref(tuple);
+		if (held != NULL)
+			tuple_unref(held);
+		held = tuple;
+		fiber_sleep(0);
+		index_seek_after(pk, it, held);
 	}
-	on_replace = txn_alter_trigger_new(on_replace_in_old_space,
-					   new_index);
-	trigger_add(&alter->old_space->on_replace, on_replace);
 }
 
 AddIndex::~AddIndex()
@@ -57,9 +57,7 @@ box_process_func box_process = process_ro;
 
 struct recovery_state *recovery;
 
-static struct evio_service binary; /* iproto binary listener */
 
-int snapshot_pid = 0; /* snapshot processes pid */
 static void
 process_ro(struct request *request, struct port *port)
 {
@@ -187,11 +185,7 @@ extern "C" void
 box_set_listen(const char *uri)
 {
 	box_check_uri(uri, "listen");
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
-
-	if (uri != NULL)
-		coio_service_start(&binary, uri);
+	iproto_set_listen(uri);
 }
 
 extern "C" void
@@ -400,6 +394,22 @@ engine_init()
 	engine_register(sophia);
 }
 
+static void
+space_reset_latency(struct space *space, void * /* udata */)
+{
+	histogram_reset(&space->latency);
+}
+
+/** Forget the latencies of requests replayed during recovery. */
+static void
+latency_cleanup()
+{
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++)
+		histogram_reset(&latency_request[i]);
+	histogram_reset(&latency_wal);
+	space_foreach(space_reset_latency, NULL);
+}
+
 static inline void
 box_init(void)
 {
@@ -433,6 +443,7 @@ box_init(void)
 	recovery_setup_panic(recovery,
 			     cfg_geti("panic_on_snap_error"),
 			     cfg_geti("panic_on_wal_error"));
+	recovery->snap_dir.compress = cfg_geti("snap_compression");
 
 	if (recovery_has_data(recovery)) {
 		/* Tell Sophia engine LSN it must recover to. */
@@ -461,7 +472,7 @@ box_init(void)
 	recovery_follow_local(recovery, cfg_getd("wal_dir_rescan_delay"));
 	title("hot_standby", NULL);
 
-	iproto_init(&binary);
+	iproto_init();
 	box_set_listen(cfg_gets("listen"));
 
 	int rows_per_wal = box_check_rows_per_wal(cfg_geti("rows_per_wal"));
@@ -471,6 +482,7 @@ box_init(void)
 	engine_end_recovery();
 
 	stat_cleanup(stat_base, IPROTO_TYPE_STAT_MAX);
+	latency_cleanup();
 
 	if (recovery_has_remote(recovery))
 		recovery_follow_remote(recovery);
@@ -502,6 +514,12 @@ box_atfork()
 	recovery_atfork(recovery);
 }
 
+bool
+box_snapshot_is_in_progress(void)
+{
+	return engine_checkpoint_is_in_progress();
+}
+
 int
 box_snapshot()
 {
@@ -68,8 +68,10 @@ box_set_ro(bool ro);
 bool
 box_is_ro(void);
 
-/** Non zero if snapshot is in progress. */
-extern int snapshot_pid;
+/** True if a snapshot is in progress. */
+bool
+box_snapshot_is_in_progress(void);
+
 /** Incremented with each next snapshot. */
 extern uint32_t snapshot_version;
 
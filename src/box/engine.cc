@@ -143,10 +143,17 @@ engine_end_recovery()
 	space_foreach(do_one_recover_step, NULL);
 }
 
+static bool snapshot_is_in_progress = false;
+
+bool
+engine_checkpoint_is_in_progress()
+{
+	return snapshot_is_in_progress;
+}
+
 int
 engine_checkpoint(int64_t checkpoint_id)
 {
-	static bool snapshot_is_in_progress = false;
 	if (snapshot_is_in_progress)
 		return EINPROGRESS;
 
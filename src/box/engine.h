@@ -48,6 +48,12 @@ enum engine_flags {
 	 * that the primary key is not changed.
 	 */
 	ENGINE_AUTO_CHECK_UPDATE = 4,
+	/**
+	 * The engine does not keep tuples in memory: a tuple of
+	 * its space only lives while a request uses it, and is
+	 * allocated outside of the memtx arena.
+	 */
+	ENGINE_TRANSIENT_TUPLES = 8,
 };
 
 extern uint32_t engine_flags[BOX_ENGINE_MAX];
@@ -115,7 +121,8 @@ public:
 	 */
 	virtual Index *createIndex(struct key_def*) = 0;
 	/**
-	 * Delete all tuples in the index on drop.
+	 * Delete all tuples in the index on drop. Called for
+	 * a secondary key as well, to release its data.
 	 */
 	virtual void dropIndex(Index*) = 0;
 	/**
@@ -221,6 +228,12 @@ engine_auto_check_update(uint32_t flags)
 	return flags & ENGINE_AUTO_CHECK_UPDATE;
 }
 
+static inline bool
+engine_transient_tuples(uint32_t flags)
+{
+	return flags & ENGINE_TRANSIENT_TUPLES;
+}
+
 static inline uint32_t
 engine_id(Handler *space)
 {
@@ -254,4 +267,8 @@ engine_end_recovery();
 int
 engine_checkpoint(int64_t checkpoint_id);
 
+/** True while engine_checkpoint() is running. */
+bool
+engine_checkpoint_is_in_progress();
+
 #endif /* TARANTOOL_BOX_ENGINE_H_INCLUDED */
@@ -30,6 +30,7 @@
 #include "tuple.h"
 #include "say.h"
 #include "schema.h"
+#include "fiber.h"
 
 STRS(iterator_type, ITERATOR_TYPE);
 
@@ -141,6 +142,10 @@ Index::buildNext(struct tuple *tuple)
 	replace(NULL, tuple, DUP_INSERT);
 }
 
+void
+Index::sortBuild()
+{}
+
 void
 Index::endBuild()
 {}
@@ -162,6 +167,18 @@ Index::random(uint32_t rnd) const
 	return NULL;
 }
 
+void
+Index::findByKeys(const char *keys, uint32_t count,
+		  struct tuple **result) const
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t part_count = mp_decode_array(&keys);
+		result[i] = findByKey(keys, part_count);
+		for (uint32_t part = 0; part < part_count; part++)
+			mp_next(&keys);
+	}
+}
+
 struct tuple *
 Index::findByTuple(struct tuple *tuple) const
 {
@@ -173,7 +190,7 @@ Index::findByTuple(struct tuple *tuple) const
 }
 
 void
-index_build(Index *index, Index *pk)
+index_build_fill(Index *index, Index *pk)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
@@ -193,8 +210,37 @@ index_build(Index *index, Index *pk)
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(Index *index, Index *pk)
+{
+	index_build_fill(index, pk);
+	index->sortBuild();
 	index->endBuild();
 }
 
+void
+index_seek_after(Index *index, struct iterator *it, struct tuple *tuple)
+{
+	struct key_def *key_def = index->key_def;
+	const char *fields[BOX_INDEX_PART_MAX];
+	size_t size = 0;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		fields[i] = tuple_field(tuple, key_def->parts[i].fieldno);
+		const char *end = fields[i];
+		mp_next(&end);
+		size += end - fields[i];
+	}
+	char *key = (char *) region_alloc(&fiber()->gc, size);
+	char *pos = key;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		const char *end = fields[i];
+		mp_next(&end);
+		memcpy(pos, fields[i], end - fields[i]);
+		pos += end - fields[i];
+	}
+	index->initIterator(it, ITER_GT, key, key_def->part_count);
+}
+
 /* }}} */
@@ -176,10 +176,27 @@ public:
 	 */
 	virtual void reserve(uint32_t /* size_hint */);
 	virtual void buildNext(struct tuple *tuple);
+	/**
+	 * Process the added tuples before endBuild(), e.g.
+	 * sort them. Must not allocate index memory or touch
+	 * anything but this index, since it may run in a
+	 * separate thread, concurrently with sortBuild() of
+	 * other indexes. Must not throw.
+	 */
+	virtual void sortBuild();
 	virtual void endBuild();
 	virtual size_t size() const = 0;
 	virtual struct tuple *random(uint32_t rnd) const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const = 0;
+	/**
+	 * Look up @a count keys at once. @a keys holds @a count
+	 * MsgPack arrays, each a full unique key, one after another.
+	 * The tuple found by i-th key, or NULL, is stored to
+	 * result[i]. Indexes may override it to overlap the memory
+	 * latency of the lookups.
+	 */
+	virtual void findByKeys(const char *keys, uint32_t count,
+				struct tuple **result) const;
 	virtual struct tuple *findByTuple(struct tuple *tuple) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
@@ -254,8 +271,22 @@ index_is_primary(const Index *index)
 	return index_id(index) == 0;
 }
 
+/**
+ * Begin building this index and add all tuples of another
+ * index to it. sortBuild() and endBuild() must follow.
+ */
+void
+index_build_fill(Index *index, Index *pk);
+
 /** Build this index based on the contents of another index. */
 void
 index_build(Index *index, Index *pk);
 
+/**
+ * Position the iterator after the given tuple in the index
+ * order, to resume a scan of a TREE index which has yielded.
+ */
+void
+index_seek_after(Index *index, struct iterator *it, struct tuple *tuple);
+
 #endif /* TARANTOOL_BOX_INDEX_H_INCLUDED */
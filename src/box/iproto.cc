@@ -50,6 +50,8 @@
 #include "stat.h"
 #include "lua/call.h"
 
+#include "cpipe.h"
+
 /* {{{ iproto_request - declaration */
 
 struct iproto_connection;
@@ -57,23 +59,35 @@ struct iproto_connection;
 typedef void (*iproto_request_f)(struct iproto_request *);
 
 /**
- * A single request from the client. All requests
- * from all clients are queued into a single queue
- * and processed in FIFO order.
+ * A single request from the client. Requests are read and
+ * decoded in the network cord and passed over to TX, where all
+ * requests from all clients are queued into a single queue and
+ * processed in FIFO order. A processed request is returned to
+ * the network cord, which sends the reply and frees the request.
  */
 struct iproto_request
 {
+	/** Link in a cord pipe. Must be the first member. */
+	struct cmsg base;
 	struct iproto_connection *connection;
 	struct iobuf *iobuf;
-	struct session *session;
 	iproto_request_f process;
 	/* Request message code and sync. */
 	struct xrow_header header;
 	/* Box request, if this is a DML */
 	struct request request;
 	size_t total_len;
+	/**
+	 * End of the output buffer after the request is
+	 * processed, set in TX. The network cord doesn't
+	 * write to the socket past this position.
+	 */
+	struct obuf_svp write_end;
+	/** Set in TX if the connection must be closed. */
+	bool close_connection;
 };
 
+/** Is used in the network cord only. */
 struct mempool iproto_request_pool;
 
 static struct iproto_request *
@@ -89,6 +103,9 @@ iproto_process_disconnect(struct iproto_request *request);
 static void
 iproto_process(struct iproto_request *request);
 
+static inline struct session *
+iproto_request_session(struct iproto_request *request);
+
 struct IprotoRequestGuard {
 	struct iproto_request *ireq;
 	IprotoRequestGuard(struct iproto_request *ireq_arg):ireq(ireq_arg) {}
@@ -100,17 +117,129 @@ struct IprotoRequestGuard {
 
 /* }}} */
 
+/* {{{ cords and pipes */
+
+/**
+ * The network cord owns the binary listener, the client sockets
+ * and the input buffers: it reads and decodes requests, and
+ * writes replies. TX processes requests and fills in the output
+ * buffers.
+ */
+static struct cord net_cord;
+/** The cord which processes requests. */
+static struct cord *tx_cord;
+/** Requests and connection events, from the network cord to TX. */
+static struct cpipe tx_pipe;
+/** Processed requests, from TX back to the network cord. */
+static struct cpipe net_pipe;
+/**
+ * Each cord publishes the messages staged during an event loop
+ * iteration in a single batch, before the loop goes to sleep.
+ */
+static struct ev_prepare tx_flush_watcher;
+static struct ev_prepare net_flush_watcher;
+/** The binary listener, owned by the network cord. */
+static struct evio_service binary;
+
+static void
+iproto_flush_pipe(ev_loop * /* loop */, struct ev_prepare *watcher,
+		  int /* events */)
+{
+	cpipe_flush((struct cpipe *) watcher->data);
+}
+
+/** Put a request received from the network cord into the queue. */
+static void
+tx_queue_request(struct cmsg *msg);
+
+/** Send a processed request back to the network cord. */
+static inline void
+iproto_request_return(struct iproto_request *ireq, cmsg_f f)
+{
+	cmsg_init(&ireq->base, f);
+	cpipe_push(&net_pipe, &ireq->base);
+}
+
+/**
+ * A synchronous call from TX to the network cord: the
+ * TX fiber waits until the message comes back.
+ */
+struct iproto_sync_msg
+{
+	struct cmsg base;
+	/** The waiting fiber. */
+	struct fiber *fiber;
+	bool done;
+	/** URI to listen on, see net_set_listen(). */
+	const char *uri;
+	/** Error raised in the network cord, if any. */
+	Exception *exception;
+};
+
+static void
+iproto_sync_msg_create(struct iproto_sync_msg *msg, const char *uri)
+{
+	msg->fiber = fiber();
+	msg->done = false;
+	msg->uri = uri;
+	Exception::init(&msg->exception);
+}
+
+static void
+tx_sync_done(struct cmsg *m)
+{
+	struct iproto_sync_msg *msg = (struct iproto_sync_msg *) m;
+	msg->done = true;
+	fiber_wakeup(msg->fiber);
+}
+
+/** Reply to a synchronous call. Invoked in the network cord. */
+static void
+net_sync_reply(struct iproto_sync_msg *msg)
+{
+	cmsg_init(&msg->base, tx_sync_done);
+	cpipe_push(&tx_pipe, &msg->base);
+}
+
+/** Wait for the reply and re-raise the error, if any. */
+static void
+iproto_sync_wait(struct iproto_sync_msg *msg)
+{
+	while (! msg->done)
+		fiber_yield();
+	if (msg->exception != NULL) {
+		Exception::move(&msg->exception, &fiber()->exception);
+		fiber()->exception->raise();
+	}
+}
+
+/** Invoke a function in the network cord and wait for it. */
+static void
+iproto_sync_call(struct iproto_sync_msg *msg, cmsg_f f)
+{
+	cmsg_init(&msg->base, f);
+	cpipe_push(&net_pipe, &msg->base);
+	cpipe_flush(&net_pipe);
+	iproto_sync_wait(msg);
+}
+
+/* }}} */
+
 /* {{{ iproto_queue */
 
 struct iproto_request;
 
 enum { IPROTO_REQUEST_QUEUE_SIZE = 2048, };
 
+/** Max number of vectors written by a single writev(). */
+enum { IPROTO_FLUSH_IOV_MAX = 64 };
+
 /**
  * Implementation of an input queue of the box request processor.
  *
- * Event handlers read data, determine request boundaries
- * and enqueue requests. Once all input/output events are
+ * The network cord reads data, determines request boundaries
+ * and passes requests to TX, where they are put into the queue.
+ * Once all events of the current event loop iteration are
  * processed, an own handler is invoked to deal with the
  * requests in the queue. It leases a fiber from a pool
  * and runs the request in the fiber.
@@ -195,9 +324,10 @@ iproto_queue_handler(va_list ap)
 	struct iproto_request *request;
 restart:
 	while ((request = iproto_queue_pop(i_queue))) {
-		IprotoRequestGuard guard(request);
-		fiber_set_session(fiber(), request->session);
-		fiber_set_user(fiber(), &request->session->credentials);
+		struct session *session = iproto_request_session(request);
+		fiber_set_session(fiber(), session);
+		fiber_set_user(fiber(), &session->credentials);
+		/* Returns the request to the network cord. */
 		request->process(request);
 	}
 	/** Put the current fiber into a queue fiber cache. */
@@ -238,11 +368,20 @@ iproto_queue_init(struct iproto_queue *i_queue)
 	rlist_create(&i_queue->fiber_cache);
 }
 
+static void
+tx_queue_request(struct cmsg *msg)
+{
+	iproto_queue_push(&request_queue, (struct iproto_request *) msg);
+}
+
 /* }}} */
 
 /* {{{ iproto_connection */
 
-/** Context of a single client connection. */
+/**
+ * Context of a single client connection. Is owned by the
+ * network cord, except the session, which is used in TX only.
+ */
 struct iproto_connection
 {
 	/**
@@ -267,6 +406,18 @@ struct iproto_connection
 	ssize_t parse_size;
 	/** Current write position in the output buffer */
 	struct obuf_svp write_pos;
+	/**
+	 * End of the complete replies in iobuf[0] and iobuf[1]
+	 * output buffers. The output buffers are filled in TX,
+	 * so the network cord never looks past these positions.
+	 */
+	struct obuf_svp write_end[2];
+	/**
+	 * How many tuple references of iobuf[0] and iobuf[1]
+	 * output TX has been told are written, see
+	 * net_release_refs().
+	 */
+	size_t refs_written[2];
 	/**
 	 * Function of the request processor to handle
 	 * a single request.
@@ -279,10 +430,25 @@ struct iproto_connection
 	ev_loop *loop;
 	/* Pre-allocated disconnect request. */
 	struct iproto_request *disconnect;
+	/**
+	 * Set by the network cord when the client is gone.
+	 * TX skips the requests still queued: there is no
+	 * one to reply to. TX may see the flag late, then a
+	 * request is executed, as it would be had it come
+	 * a bit earlier.
+	 */
+	bool is_closed;
 };
 
+/** Is used in the network cord only. */
 static struct mempool iproto_connection_pool;
 
+static inline struct session *
+iproto_request_session(struct iproto_request *request)
+{
+	return request->connection->session;
+}
+
 /**
  * A connection is idle when the client is gone
  * and there are no outstanding requests in the request queue.
@@ -300,6 +466,17 @@ iproto_connection_is_idle(struct iproto_connection *con)
 		ibuf_size(&con->iobuf[1]->in) == 0;
 }
 
+/**
+ * Size of the requests in iobuf[i] which are parsed
+ * and not yet returned from TX.
+ */
+static inline size_t
+iproto_connection_in_progress(struct iproto_connection *con, int i)
+{
+	size_t size = ibuf_size(&con->iobuf[i]->in);
+	return i == 0 ? size - con->parse_size : size;
+}
+
 static void
 iproto_connection_on_input(ev_loop * /* loop */, struct ev_io *watcher,
 			   int /* revents */);
@@ -316,32 +493,33 @@ iproto_connection_new(const char *name, int fd, struct sockaddr *addr)
 	con->loop = loop();
 	ev_io_init(&con->input, iproto_connection_on_input, fd, EV_READ);
 	ev_io_init(&con->output, iproto_connection_on_output, fd, EV_WRITE);
-	con->iobuf[0] = iobuf_new(name);
-	con->iobuf[1] = iobuf_new(name);
+	/* Output buffers are filled in TX, in TX memory. */
+	con->iobuf[0] = iobuf_new_mt(name, &tx_cord->slabc);
+	con->iobuf[1] = iobuf_new_mt(name, &tx_cord->slabc);
 	con->parse_size = 0;
 	con->write_pos = obuf_create_svp(&con->iobuf[0]->out);
+	con->write_end[0] = con->write_end[1] = con->write_pos;
+	con->refs_written[0] = con->refs_written[1] = 0;
 	con->session = NULL;
 	con->cookie = *(uint64_t *) addr;
+	con->is_closed = false;
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_request_new(con, iproto_process_disconnect);
 	return con;
 }
 
-/** Recycle a connection. Never throws. */
+/**
+ * Recycle a connection, after its session is destroyed
+ * in TX. Never throws.
+ */
 static inline void
 iproto_connection_delete(struct iproto_connection *con)
 {
 	assert(iproto_connection_is_idle(con));
 	assert(!evio_is_active(&con->output));
-	if (con->session) {
-		if (! rlist_empty(&session_on_disconnect))
-			session_run_on_disconnect_triggers(con->session);
-		session_destroy(con->session);
-	}
-	iobuf_delete(con->iobuf[0]);
-	iobuf_delete(con->iobuf[1]);
-	if (con->disconnect)
-		mempool_free(&iproto_request_pool, con->disconnect);
+	assert(con->disconnect == NULL);
+	iobuf_delete_mt(con->iobuf[0]);
+	iobuf_delete_mt(con->iobuf[1]);
 	mempool_free(&iproto_connection_pool, con);
 }
 
@@ -351,11 +529,13 @@ iproto_connection_shutdown(struct iproto_connection *con)
 	ev_io_stop(con->loop, &con->input);
 	ev_io_stop(con->loop, &con->output);
 	con->input.fd = con->output.fd = -1;
+	con->is_closed = true;
 	/*
 	 * Discard unparsed data, to recycle the con
 	 * as soon as all parsed data is processed.
 	 */
 	con->iobuf[0]->in.end -= con->parse_size;
+	con->parse_size = 0;
 	/*
 	 * If the con is not idle, it is destroyed
 	 * after the last request is handled. Otherwise,
@@ -367,7 +547,7 @@ iproto_connection_shutdown(struct iproto_connection *con)
 	if (iproto_connection_is_idle(con)) {
 		struct iproto_request *ireq = con->disconnect;
 		con->disconnect = NULL;
-		iproto_queue_push(&request_queue, ireq);
+		cpipe_push(&tx_pipe, &ireq->base);
 	}
 }
 
@@ -393,8 +573,8 @@ iproto_connection_close(struct iproto_connection *con)
  *   the previous strategy. It is only safe to stop input if it
  *   is known that there is output. In this case input event
  *   flow will be resumed when all replies to previous requests
- *   are sent, in iproto_connection_gc_iobuf(). Since there are two
- *   buffers, the input is only stopped when both of them
+ *   are sent, in iproto_connection_on_output(). Since there are
+ *   two buffers, the input is only stopped when both of them
  *   are fully used up.
  *
  * To make this strategy work, each iobuf in use must fit at
@@ -425,7 +605,8 @@ iproto_connection_input_iobuf(struct iproto_connection *con)
 		return oldbuf;
 	}
 
-	if (! iobuf_is_idle(con->iobuf[1])) {
+	if (ibuf_size(&con->iobuf[1]->in) != 0 ||
+	    con->write_end[1].size != 0) {
 		/*
 		 * Wait until the second buffer is flushed
 		 * and becomes available for reuse.
@@ -449,6 +630,12 @@ iproto_connection_input_iobuf(struct iproto_connection *con)
 	 */
 	con->iobuf[1] = oldbuf;
 	con->iobuf[0] = newbuf;
+	struct obuf_svp write_end = con->write_end[1];
+	con->write_end[1] = con->write_end[0];
+	con->write_end[0] = write_end;
+	size_t refs_written = con->refs_written[1];
+	con->refs_written[1] = con->refs_written[0];
+	con->refs_written[0] = refs_written;
 	return newbuf;
 }
 
@@ -495,11 +682,21 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 				       ireq->header.body[0].iov_len);
 		}
 		ireq->request.header = &ireq->header;
-		iproto_queue_push(&request_queue, guard.release());
-		/* Request will be discarded in iproto_process_XXX */
+		cpipe_push(&tx_pipe, &guard.release()->base);
+		/* Request will be discarded in net_send_reply() */
 
 		/* Request is parsed */
 		con->parse_size -= reqend - reqstart;
+		if (ireq->header.type == IPROTO_JOIN ||
+		    ireq->header.type == IPROTO_SUBSCRIBE) {
+			/*
+			 * The socket is handed over to replication
+			 * in TX, stop all I/O on it. The connection
+			 * is recycled when the request is returned.
+			 */
+			iproto_connection_shutdown(con);
+			break;
+		}
 		if (con->parse_size == 0)
 			break;
 	}
@@ -542,7 +739,7 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		 * Keep reading input, as long as the socket
 		 * supplies data.
 		 */
-		if (!ev_is_active(&con->input))
+		if (evio_is_active(&con->input) && !ev_is_active(&con->input))
 			ev_feed_event(loop, &con->input, EV_READ);
 	} catch (Exception *e) {
 		e->log();
@@ -550,53 +747,92 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
-/** Get the iobuf which is currently being flushed. */
-static inline struct iobuf *
+/**
+ * Get the index of the iobuf which is currently being flushed.
+ * Don't try to write from a newer buffer if an older one
+ * exists: in case of a partial write of a newer buffer,
+ * the client may end up getting a salad of different
+ * pieces of replies from both buffers.
+ */
+static inline int
 iproto_connection_output_iobuf(struct iproto_connection *con)
 {
-	if (obuf_size(&con->iobuf[1]->out))
-		return con->iobuf[1];
-	/*
-	 * Don't try to write from a newer buffer if an older one
-	 * exists: in case of a partial write of a newer buffer,
-	 * the client may end up getting a salad of different
-	 * pieces of replies from both buffers.
-	 */
-	if (ibuf_size(&con->iobuf[1]->in) == 0 &&
-	    obuf_size(&con->iobuf[0]->out))
-		return con->iobuf[0];
-	return NULL;
+	if (con->write_end[1].size != 0 || ibuf_size(&con->iobuf[1]->in))
+		return 1;
+	return 0;
 }
 
-/** writev() to the socket and handle the output. */
+/**
+ * writev() the output between the savepoints to the socket.
+ * The vector is built from the savepoints only, since TX may
+ * be appending to the output buffer concurrently: the iovec
+ * array of the end savepoint is used, which TX never changes
+ * below the savepoint position. It is built
+ * and written in batches: a reply referencing many tuples
+ * takes as many vectors.
+ * @retval 0 all output up to the end is written
+ * @retval -1 the socket is not ready
+ */
 static int
-iproto_flush(struct iobuf *iobuf, int fd, struct obuf_svp *svp)
+iproto_flush(int fd, struct obuf_svp *begin, struct obuf_svp *end)
 {
-	/* Begin writing from the saved position. */
-	struct iovec *iov = iobuf->out.iov + svp->pos;
-	int iovcnt = obuf_iovcnt(&iobuf->out) - svp->pos;
-	assert(iovcnt);
-	ssize_t nwr;
-	try {
-		sio_add_to_iov(iov, -svp->iov_len);
-		nwr = sio_writev(fd, iov, iovcnt);
-
-		sio_add_to_iov(iov, svp->iov_len);
-	} catch (SocketError *) {
-		sio_add_to_iov(iov, svp->iov_len);
-		throw;
-	}
-
-	if (nwr > 0) {
-		if (svp->size + nwr == obuf_size(&iobuf->out)) {
-			iobuf_reset(iobuf);
-			*svp = obuf_create_svp(&iobuf->out);
+	while (begin->size != end->size) {
+		struct iovec iov[IPROTO_FLUSH_IOV_MAX];
+		int iovcnt = 0;
+		size_t size = 0;
+		const struct iovec *out = end->iov;
+		for (size_t pos = begin->pos;
+		     pos < end->pos && iovcnt < IPROTO_FLUSH_IOV_MAX; pos++) {
+			iov[iovcnt] = out[pos];
+			size += iov[iovcnt++].iov_len;
+		}
+		if (begin->pos + iovcnt == end->pos && end->iov_len > 0 &&
+		    iovcnt < IPROTO_FLUSH_IOV_MAX) {
+			iov[iovcnt].iov_base = out[end->pos].iov_base;
+			iov[iovcnt++].iov_len = end->iov_len;
+			size += end->iov_len;
+		}
+		assert(iovcnt);
+		size -= begin->iov_len;
+		/* Begin writing from the saved position. */
+		sio_add_to_iov(iov, -begin->iov_len);
+		ssize_t nwr = sio_writev(fd, iov, iovcnt);
+		sio_add_to_iov(iov, begin->iov_len);
+
+		if (nwr <= 0)
+			return -1;
+		if (begin->size + nwr == end->size) {
+			*begin = *end;
 			return 0;
 		}
-		svp->size += nwr;
-		svp->pos += sio_move_iov(iov, nwr, &svp->iov_len);
+		begin->size += nwr;
+		begin->pos += sio_move_iov(iov, nwr, &begin->iov_len);
+		if ((size_t) nwr < size)
+			return -1;
 	}
-	return -1;
+	return 0;
+}
+
+/** Unpin the tuples written by the network cord. */
+static void
+tx_release_refs(struct cmsg *msg);
+
+/**
+ * The output of iobuf[i] is written up to its end: let TX
+ * release the tuples it references, so that they don't stay
+ * pinned until the next request or disconnect.
+ */
+static void
+net_release_refs(struct iproto_connection *con, int i)
+{
+	if (con->write_end[i].refs == con->refs_written[i])
+		return;
+	struct iproto_request *ireq = iproto_request_new(con, NULL);
+	cmsg_init(&ireq->base, tx_release_refs);
+	ireq->iobuf = con->iobuf[i];
+	ireq->write_end = con->write_end[i];
+	con->refs_written[i] = con->write_end[i].refs;
+	cpipe_push(&tx_pipe, &ireq->base);
 }
 
 static void
@@ -608,14 +844,27 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	struct obuf_svp *svp = &con->write_pos;
 
 	try {
-		struct iobuf *iobuf;
-		while ((iobuf = iproto_connection_output_iobuf(con))) {
-			if (iproto_flush(iobuf, fd, svp) < 0) {
+		while (true) {
+			int i = iproto_connection_output_iobuf(con);
+			struct iobuf *iobuf = con->iobuf[i];
+			if (iproto_flush(fd, svp, &con->write_end[i]) < 0) {
 				ev_io_start(loop, &con->output);
 				return;
 			}
+			net_release_refs(con, i);
+			/*
+			 * TX may still be writing replies to the
+			 * requests in progress.
+			 */
+			if (iproto_connection_in_progress(con, i))
+				break;
+			iobuf_reset(iobuf);
+			obuf_svp_reset(&iobuf->out, &con->write_end[i]);
+			*svp = con->write_end[i];
 			if (! ev_is_active(&con->input))
 				ev_feed_event(loop, &con->input, EV_READ);
+			if (i == 0)
+				break;
 		}
 		if (ev_is_active(&con->output))
 			ev_io_stop(loop, &con->output);
@@ -625,6 +874,84 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	}
 }
 
+/**
+ * A request is processed in TX: discard its input
+ * and send the reply.
+ */
+static void
+net_send_reply(struct cmsg *msg)
+{
+	struct iproto_request *ireq = (struct iproto_request *) msg;
+	struct iproto_connection *con = ireq->connection;
+	struct iobuf *iobuf = ireq->iobuf;
+	int i = iobuf == con->iobuf[0] ? 0 : 1;
+	assert(iobuf == con->iobuf[i]);
+
+	/* Discard request (see iproto_enqueue_batch()) */
+	iobuf->in.pos += ireq->total_len;
+	if (ireq->write_end.size > con->write_end[i].size)
+		con->write_end[i] = ireq->write_end;
+	mempool_free(&iproto_request_pool, ireq);
+
+	if (evio_is_active(&con->output)) {
+		if (! ev_is_active(&con->output))
+			ev_feed_event(con->loop, &con->output, EV_WRITE);
+	} else if (iproto_connection_is_idle(con)) {
+		struct iproto_request *disconnect = con->disconnect;
+		con->disconnect = NULL;
+		cpipe_push(&tx_pipe, &disconnect->base);
+	}
+}
+
+/**
+ * The handshake is done in TX: send the greeting and start
+ * reading input, or send the error and close the connection.
+ */
+static void
+net_send_greeting(struct cmsg *msg)
+{
+	struct iproto_request *ireq = (struct iproto_request *) msg;
+	struct iproto_connection *con = ireq->connection;
+	con->write_end[0] = ireq->write_end;
+	bool close_connection = ireq->close_connection;
+	mempool_free(&iproto_request_pool, ireq);
+	if (close_connection) {
+		try {
+			iproto_flush(con->output.fd, &con->write_pos,
+				     &con->write_end[0]);
+		} catch (Exception *e) {
+			e->log();
+		}
+		iproto_connection_close(con);
+		return;
+	}
+	/*
+	 * Connect is synchronous, so no one could have been
+	 * messing up with the connection while it was in
+	 * progress.
+	 */
+	assert(evio_is_active(&con->input));
+	/* Handshake OK, send the greeting and start reading input. */
+	ev_feed_event(con->loop, &con->output, EV_WRITE);
+	ev_feed_event(con->loop, &con->input, EV_READ);
+}
+
+/** TX has released the references of the request. */
+static void
+net_free_request(struct cmsg *msg)
+{
+	mempool_free(&iproto_request_pool, msg);
+}
+
+/** The session is destroyed in TX, free the connection. */
+static void
+net_finish_disconnect(struct cmsg *msg)
+{
+	struct iproto_request *ireq = (struct iproto_request *) msg;
+	iproto_connection_delete(ireq->connection);
+	mempool_free(&iproto_request_pool, ireq);
+}
+
 /* }}} */
 
 /* {{{ iproto_process_* functions */
@@ -636,21 +963,19 @@ iproto_process(struct iproto_request *ireq)
 	struct obuf *out = &iobuf->out;
 	struct iproto_connection *con = ireq->connection;
 
+	uint32_t type = ireq->header.type;
+	int64_t start = clock_monotonic64();
 	auto scope_guard = make_scoped_guard([=]{
-		/* Discard request (see iproto_enqueue_batch()) */
-		iobuf->in.pos += ireq->total_len;
-
-		if (evio_is_active(&con->output)) {
-			if (! ev_is_active(&con->output))
-				ev_feed_event(con->loop,
-					      &con->output,
-					      EV_WRITE);
-		} else if (iproto_connection_is_idle(con)) {
-			iproto_connection_delete(con);
+		if (type < IPROTO_TYPE_STAT_MAX) {
+			histogram_collect(&latency_request[type],
+					  clock_monotonic64() - start);
 		}
+		/* The reply is complete, let the network cord send it. */
+		ireq->write_end = obuf_create_svp(out);
+		iproto_request_return(ireq, net_send_reply);
 	});
 
-	if (unlikely(! evio_is_active(&con->output)))
+	if (unlikely(con->is_closed))
 		return;
 
 	struct obuf_svp svp = obuf_create_svp(out);
@@ -690,18 +1015,14 @@ iproto_process(struct iproto_request *ireq)
 			iproto_reply_ok(&ireq->iobuf->out, ireq->header.sync);
 			break;
 		case IPROTO_JOIN:
-			ev_io_stop(con->loop, &con->input);
-			ev_io_stop(con->loop, &con->output);
-			box_process_join(con->input.fd, &ireq->header);
-			/* TODO: check requests in `con' queue */
-			iproto_connection_shutdown(con);
+			/*
+			 * The network cord has stopped I/O on
+			 * the socket, see iproto_enqueue_batch().
+			 */
+			box_process_join(con->session->fd, &ireq->header);
 			return;
 		case IPROTO_SUBSCRIBE:
-			ev_io_stop(con->loop, &con->input);
-			ev_io_stop(con->loop, &con->output);
-			box_process_subscribe(con->input.fd, &ireq->header);
-			/* TODO: check requests in `con' queue */
-			iproto_connection_shutdown(con);
+			box_process_subscribe(con->session->fd, &ireq->header);
 			return;
 		default:
 			tnt_raise(ClientError, ER_UNKNOWN_REQUEST_TYPE,
@@ -719,10 +1040,11 @@ iproto_request_new(struct iproto_connection *con,
 {
 	struct iproto_request *ireq =
 		(struct iproto_request *) mempool_alloc(&iproto_request_pool);
+	cmsg_init(&ireq->base, tx_queue_request);
 	ireq->connection = con;
 	ireq->iobuf = con->iobuf[0];
-	ireq->session = con->session;
 	ireq->process = process;
+	ireq->close_connection = false;
 	return ireq;
 }
 
@@ -748,43 +1070,49 @@ static void
 iproto_process_connect(struct iproto_request *request)
 {
 	struct iproto_connection *con = request->connection;
-	struct iobuf *iobuf = request->iobuf;
-	int fd = con->input.fd;
+	struct obuf *out = &request->iobuf->out;
 	try {              /* connect. */
-		con->session = session_create(fd, con->cookie);
-		coio_write(&con->input, iproto_greeting(con->session->salt),
-			   IPROTO_GREETING_SIZE);
+		con->session = session_create(con->input.fd, con->cookie);
+		/* The greeting is sent by the network cord. */
+		obuf_dup(out, iproto_greeting(con->session->salt),
+			 IPROTO_GREETING_SIZE);
 		if (! rlist_empty(&session_on_connect))
 			session_run_on_connect_triggers(con->session);
-	} catch (SocketError *e) {
-		e->log();
-		iproto_connection_close(con);
-		return;
 	} catch (Exception *e) {
-		iproto_reply_error(&iobuf->out, e, request->header.type);
-		try {
-			iproto_flush(iobuf, fd, &con->write_pos);
-		} catch (Exception *e) {
-			e->log();
-		}
-		iproto_connection_close(con);
-		return;
+		iproto_reply_error(out, e, 0);
+		request->close_connection = true;
 	}
-	/*
-	 * Connect is synchronous, so no one could have been
-	 * messing up with the connection while it was in
-	 * progress.
-	 */
-	assert(evio_is_active(&con->input));
-	/* Handshake OK, start reading input. */
-	ev_feed_event(con->loop, &con->input, EV_READ);
+	request->write_end = obuf_create_svp(out);
+	iproto_request_return(request, net_send_greeting);
 }
 
 static void
 iproto_process_disconnect(struct iproto_request *request)
 {
-	/* Runs the trigger, which may yield. */
-	iproto_connection_delete(request->connection);
+	struct iproto_connection *con = request->connection;
+	if (con->session) {
+		/* Runs the trigger, which may yield. */
+		if (! rlist_empty(&session_on_disconnect))
+			session_run_on_disconnect_triggers(con->session);
+		session_destroy(con->session);
+	}
+	/* Output buffers use TX memory. */
+	for (int i = 0; i < 2; i++) {
+		struct obuf *out = &con->iobuf[i]->out;
+		struct obuf_svp svp = obuf_create_svp(out);
+		iproto_release_tuples(out, &svp);
+	}
+	iobuf_delete_out(con->iobuf[0]);
+	iobuf_delete_out(con->iobuf[1]);
+	iproto_request_return(request, net_finish_disconnect);
+}
+
+static void
+tx_release_refs(struct cmsg *msg)
+{
+	struct iproto_request *ireq = (struct iproto_request *) msg;
+	iproto_release_tuples(&ireq->iobuf->out, &ireq->write_end);
+	iproto_request_return(ireq, net_free_request);
 }
 
 /** }}} */
@@ -810,21 +1138,85 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 	 */
 	struct iproto_request *ireq =
 		iproto_request_new(con, iproto_process_connect);
-	iproto_queue_push(&request_queue, ireq);
+	cpipe_push(&tx_pipe, &ireq->base);
 }
 
-/** Initialize a read-write port. */
-void
-iproto_init(struct evio_service *service)
+static void
+net_on_bind(void *arg)
 {
+	evio_service_on_bind(&binary, NULL, NULL);
+	net_sync_reply((struct iproto_sync_msg *) arg);
+}
+
+/**
+ * Restart the binary listener on a new URI. Replies
+ * as soon as the port is bound.
+ */
+static void
+net_set_listen(struct cmsg *msg)
+{
+	struct iproto_sync_msg *m = (struct iproto_sync_msg *) msg;
+	try {
+		if (evio_service_is_active(&binary))
+			evio_service_stop(&binary);
+		if (m->uri != NULL) {
+			evio_service_on_bind(&binary, net_on_bind, m);
+			evio_service_start(&binary, m->uri);
+			return;
+		}
+	} catch (Exception *) {
+		evio_service_on_bind(&binary, NULL, NULL);
+		Exception::move(&fiber()->exception, &m->exception);
+	}
+	net_sync_reply(m);
+}
+
+/** The network cord main loop. */
+static void *
+net_cord_f(void *arg)
+{
+	iobuf_init();
 	mempool_create(&iproto_request_pool, &cord()->slabc,
 		       sizeof(struct iproto_request));
-	iproto_queue_init(&request_queue);
 	mempool_create(&iproto_connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
-
-	evio_service_init(loop(), service, "binary",
+	evio_service_init(loop(), &binary, "binary",
 			  iproto_on_accept, NULL);
+	cpipe_create(&net_pipe);
+	ev_prepare_init(&net_flush_watcher, iproto_flush_pipe);
+	net_flush_watcher.data = &tx_pipe;
+	ev_prepare_start(loop(), &net_flush_watcher);
+	/* Let TX know the network cord is ready. */
+	net_sync_reply((struct iproto_sync_msg *) arg);
+	ev_run(loop(), 0);
+	return NULL;
+}
+
+/** Initialize a read-write port. */
+void
+iproto_init()
+{
+	tx_cord = cord();
+	iproto_queue_init(&request_queue);
+	cpipe_create(&tx_pipe);
+
+	struct iproto_sync_msg ready;
+	iproto_sync_msg_create(&ready, NULL);
+	if (cord_start(&net_cord, "iproto", net_cord_f, &ready))
+		tnt_raise(SystemError, "failed to start the network thread");
+	iproto_sync_wait(&ready);
+
+	ev_prepare_init(&tx_flush_watcher, iproto_flush_pipe);
+	tx_flush_watcher.data = &net_pipe;
+	ev_prepare_start(loop(), &tx_flush_watcher);
+}
+
+void
+iproto_set_listen(const char *uri)
+{
+	struct iproto_sync_msg msg;
+	iproto_sync_msg_create(&msg, uri);
+	iproto_sync_call(&msg, net_set_listen);
 }
 
 /* vim: set foldmethod=marker */
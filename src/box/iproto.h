@@ -28,6 +28,17 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+/**
+ * Start the network thread, which accepts connections
+ * and reads requests for processing in the current cord.
+ */
+void
+iproto_init();
+
+/**
+ * Bind to the URI and start accepting connections, or stop
+ * accepting if the URI is NULL. Yields until the port is bound.
+ */
 void
-iproto_init(struct evio_service *service);
+iproto_set_listen(const char *uri);
 #endif
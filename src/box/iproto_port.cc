@@ -117,6 +117,12 @@ iproto_port(struct port *port)
 
 enum { SVP_SIZE = sizeof(iproto_header_bin) + sizeof(iproto_body_bin) };
 
+/**
+ * Tuples smaller than this are copied into the output buffer:
+ * for them, a copy is cheaper than an extra iovec and a pin.
+ */
+enum { IPROTO_TUPLE_REF_MIN = 1024 };
+
 static inline void
 iproto_port_eof(struct port *ptr)
 {
@@ -153,6 +159,22 @@ iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 	memcpy(pos + sizeof(header), &body, sizeof(body));
 }
 
+void
+iproto_encode_tuple(struct obuf *out, struct tuple *tuple)
+{
+	/*
+	 * Large tuples are not copied: the buffer references
+	 * them, and they are pinned until the reply is sent.
+	 */
+	if (tuple->bsize < IPROTO_TUPLE_REF_MIN ||
+	    tuple->refs + 1 > TUPLE_REF_MAX) {
+		tuple_to_obuf(tuple, out);
+		return;
+	}
+	obuf_add_ref(out, tuple->data, tuple->bsize, tuple);
+	tuple_ref(tuple);
+}
+
 static inline void
 iproto_port_add_tuple(struct port *ptr, struct tuple *tuple)
 {
@@ -161,7 +183,19 @@ iproto_port_add_tuple(struct port *ptr, struct tuple *tuple)
 		/* Found the first tuple, add header. */
 		port->svp = iproto_prepare_select(port->buf);
 	}
-	tuple_to_obuf(tuple, port->buf);
+	iproto_encode_tuple(port->buf, tuple);
+}
+
+static void
+iproto_unref_tuple(void *tuple)
+{
+	tuple_unref((struct tuple *) tuple);
+}
+
+void
+iproto_release_tuples(struct obuf *out, struct obuf_svp *svp)
+{
+	obuf_release_refs(out, svp, iproto_unref_tuple);
 }
 
 struct port_vtab iproto_port_vtab = {
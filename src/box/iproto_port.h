@@ -93,4 +93,19 @@ void
 iproto_reply_select(struct obuf *buf, struct obuf_svp *svp, uint64_t sync,
 		    uint32_t count);
 
+/**
+ * Append a tuple to a reply. Large tuples are referenced
+ * rather than copied, see iproto_release_tuples().
+ */
+void
+iproto_encode_tuple(struct obuf *out, struct tuple *tuple);
+
+/**
+ * Unpin the tuples referenced by the output buffer before the
+ * savepoint. Must be called in TX once the buffer contents up
+ * to the savepoint have been written out.
+ */
+void
+iproto_release_tuples(struct obuf *out, struct obuf_svp *svp);
+
 #endif /* TARANTOOL_IPROTO_PORT_H_INCLUDED */
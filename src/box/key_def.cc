@@ -88,6 +88,7 @@ key_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	def->part_count = part_count;
 
 	memset(def->parts, 0, parts_size);
+	key_def_set_compare(def);
 	return def;
 }
 
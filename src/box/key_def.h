@@ -103,6 +103,19 @@ struct key_part {
 	enum field_type type;
 };
 
+struct key_def;
+struct tuple;
+
+/** @copydoc tuple_compare() */
+typedef int (*tuple_compare_t)(const struct tuple *tuple_a,
+			       const struct tuple *tuple_b,
+			       const struct key_def *key_def);
+/** @copydoc tuple_compare_with_key() */
+typedef int (*tuple_compare_with_key_t)(const struct tuple *tuple_a,
+					const char *key,
+					uint32_t part_count,
+					const struct key_def *key_def);
+
 /* Descriptor of a multipart key. */
 struct key_def {
 	/* A link in key list. */
@@ -119,6 +132,12 @@ struct key_def {
 	enum index_type type;
 	/** Is this key unique. */
 	bool is_unique;
+	/**
+	 * Comparators of tuples by this key, specialized for
+	 * the key parts, see key_def_set_compare().
+	 */
+	tuple_compare_t tuple_compare;
+	tuple_compare_with_key_t tuple_compare_with_key;
 	/** Description of parts of a multipart index. */
 	struct key_part parts[];
 };
@@ -128,6 +147,13 @@ struct key_def *
 key_def_new(uint32_t space_id, uint32_t iid, const char *name,
 	    enum index_type type, bool is_unique, uint32_t part_count);
 
+/**
+ * Choose the tuple comparators best suited for the key
+ * parts. Implemented in tuple_compare.cc.
+ */
+void
+key_def_set_compare(struct key_def *def);
+
 static inline struct key_def *
 key_def_dup(struct key_def *def)
 {
@@ -137,6 +163,7 @@ key_def_dup(struct key_def *def)
 	if (dup) {
 		memcpy(dup->parts, def->parts,
 		       def->part_count * sizeof(*def->parts));
+		key_def_set_compare(dup);
 	}
 	return dup;
 }
@@ -169,6 +196,7 @@ key_def_set_part(struct key_def *def, uint32_t part_no,
 	assert(part_no < def->part_count);
 	def->parts[part_no].fieldno = fieldno;
 	def->parts[part_no].type = type;
+	key_def_set_compare(def);
 }
 
 /** Compare two key part arrays.
@@ -291,6 +291,34 @@ boxffi_select(struct port_ffi *port, uint32_t space_id, uint32_t index_id,
 	}
 }
 
+/**
+ * SELECT through the Lua C API rather than FFI, for engines
+ * which may yield while reading: a fiber must not yield
+ * inside an FFI call. The key is MsgPack-encoded.
+ */
+static int
+lbox_select(lua_State *L)
+{
+	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2) ||
+	    !lua_isnumber(L, 3) || !lua_isnumber(L, 4) || !lua_isnumber(L, 5) ||
+	    !lua_isstring(L, 6))
+		return luaL_error(L, "Usage index:select(key, opts)");
+
+	struct request request;
+	request_create(&request, IPROTO_SELECT);
+	size_t key_len;
+	request.key = lua_tolstring(L, 6, &key_len);
+	request.key_end = request.key + key_len;
+	request.space_id = lua_tointeger(L, 1);
+	request.index_id = lua_tointeger(L, 2);
+	request.iterator = lua_tointeger(L, 3);
+	request.offset = lua_tointeger(L, 4);
+	request.limit = lua_tointeger(L, 5);
+	struct port *port = port_lua_table_create(L);
+	box_process(&request, port);
+	return 1;
+}
+
 static int
 lbox_insert(lua_State *L)
 {
@@ -524,6 +552,155 @@ SetuidGuard::~SetuidGuard()
 		fiber_set_user(fiber(), orig_credentials);
 }
 
+/**
+ * Lua threads to run CALL and EVAL requests in. A new thread
+ * costs a garbage collected allocation and a registry
+ * reference, so threads of successful requests are kept
+ * for reuse. A thread which has raised an error is dropped.
+ */
+enum { LUA_THREAD_CACHE_MAX = 64 };
+static struct {
+	struct lua_State *L;
+	int ref;
+} lua_thread_cache[LUA_THREAD_CACHE_MAX];
+static int lua_thread_cache_size;
+
+struct LuaThreadGuard
+{
+	struct lua_State *L;
+	int ref;
+	bool is_active;
+
+	LuaThreadGuard();
+	~LuaThreadGuard()
+	{ if (is_active) luaL_unref(tarantool_L, LUA_REGISTRYINDEX, ref); }
+	/** The request is done, put the thread back to the cache. */
+	void release();
+};
+
+LuaThreadGuard::LuaThreadGuard()
+	:L(NULL), ref(LUA_NOREF), is_active(false)
+{
+	if (lua_thread_cache_size > 0) {
+		lua_thread_cache_size--;
+		L = lua_thread_cache[lua_thread_cache_size].L;
+		ref = lua_thread_cache[lua_thread_cache_size].ref;
+	} else {
+		L = lua_newthread(tarantool_L);
+		ref = luaL_ref(tarantool_L, LUA_REGISTRYINDEX);
+	}
+	is_active = true;
+}
+
+void
+LuaThreadGuard::release()
+{
+	if (lua_status(L) != 0 ||
+	    lua_thread_cache_size == LUA_THREAD_CACHE_MAX)
+		return;
+	lua_settop(L, 0);
+	lua_thread_cache[lua_thread_cache_size].L = L;
+	lua_thread_cache[lua_thread_cache_size].ref = ref;
+	lua_thread_cache_size++;
+	is_active = false;
+}
+
+/**
+ * Encode a value returned by a stored procedure as a tuple
+ * of the reply. A box.tuple is sent as is, and, if \a pin is
+ * set, large tuples are referenced rather than copied.
+ * A scalar is wrapped into a tuple with a single field.
+ */
+static void
+call_encode_row(struct lua_State *L, struct obuf *out, int idx, bool pin)
+{
+	struct tuple *tuple = lua_istuple(L, idx);
+	if (tuple != NULL && pin) {
+		iproto_encode_tuple(out, tuple);
+	} else if (tuple != NULL || lua_istable(L, idx)) {
+		luamp_encode_tuple(L, luaL_msgpack_default, out, idx);
+	} else {
+		luamp_encode_array(luaL_msgpack_default, out, 1);
+		luamp_encode(L, luaL_msgpack_default, out, idx);
+	}
+}
+
+/**
+ * True if the value is a function or an iterator object of
+ * the fun module, such as one returned by index:pairs().
+ *
+ * Any function returned by a procedure is taken for an
+ * iterator. Before iterators were supported, returning a
+ * function failed with "unsupported Lua type". Other tables,
+ * even callable ones, are still sent as tuples.
+ */
+static bool
+lua_is_iterator(struct lua_State *L, int idx)
+{
+	if (lua_isfunction(L, idx))
+		return true;
+	if (! lua_istable(L, idx))
+		return false;
+	/* fun.wrap() keeps the generator in a raw "gen" field. */
+	lua_pushstring(L, "gen");
+	lua_rawget(L, idx);
+	bool has_gen = lua_isfunction(L, -1);
+	lua_pop(L, 1);
+	if (! has_gen || ! luaL_getmetafield(L, idx, "__call"))
+		return false;
+	lua_pop(L, 1);
+	return true;
+}
+
+/**
+ * Send the values produced by an iterator returned from a
+ * stored procedure: gen, param, state on the stack, as
+ * in the generic for loop. Each iteration adds a tuple
+ * with its last value, e.g. the tuple of index:pairs(),
+ * so that large results do not have to be collected in
+ * a Lua table first. The values themselves are still Lua
+ * objects, e.g. index:pairs() blesses a tuple per row, but
+ * each is garbage as soon as it has been encoded.
+ *
+ * The iterator may yield, while the reply buffer is shared
+ * by all requests of the connection and must only grow by
+ * complete replies. The rows are therefore accumulated in
+ * a private region and appended to the reply at once.
+ */
+static void
+call_reply_iterator(struct lua_State *L, struct request *request,
+		    struct obuf *out)
+{
+	struct region pool;
+	region_create(&pool, &cord()->slabc);
+	auto pool_guard = make_scoped_guard([&]{ region_destroy(&pool); });
+	struct obuf rows;
+	obuf_create(&rows, &pool, LUAMP_ALLOC_FACTOR);
+
+	uint32_t count = 0;
+	lua_settop(L, 3);
+	while (true) {
+		lua_pushvalue(L, 1);
+		lua_pushvalue(L, 2);
+		lua_pushvalue(L, 3);
+		lua_call(L, 2, LUA_MULTRET);
+		int top = lua_gettop(L);
+		if (top == 3 || lua_isnil(L, 4))
+			break;
+		call_encode_row(L, &rows, top, false);
+		++count;
+		/* The first value is the new state. */
+		lua_pushvalue(L, 4);
+		lua_replace(L, 3);
+		lua_settop(L, 3);
+	}
+
+	struct obuf_svp svp = iproto_prepare_select(out);
+	for (int i = 0; i < obuf_iovcnt(&rows); i++)
+		obuf_dup(out, rows.iov[i].iov_base, rows.iov[i].iov_len);
+	iproto_reply_select(out, &svp, request->header->sync, count);
+}
+
 /**
  * Invoke a Lua stored procedure from the binary protocol
  * (implementation of 'CALL' command code).
@@ -571,13 +748,23 @@ execute_call(lua_State *L, struct request *request, struct obuf *out)
 	 * a tuple. This way very large lists of return values can
 	 * be used, since Lua stack size is limited by 8000 elements,
 	 * while Lua table size is pretty much unlimited.
+	 *
+	 * If the procedure returns an iterator, the values it
+	 * produces are sent without building such a table.
+	 * The iterator is called until it returns nil: one that
+	 * never does keeps the request running forever, and
+	 * unless it yields, blocks all other requests in TX.
 	 */
+	int nrets = lua_gettop(L);
+	if (nrets > 0 && lua_is_iterator(L, 1)) {
+		call_reply_iterator(L, request, out);
+		return;
+	}
 
 	uint32_t count = 0;
 	struct obuf_svp svp = iproto_prepare_select(out);
 
 	/** Check if we deal with a table of tables. */
-	int nrets = lua_gettop(L);
 	if (nrets == 1 && lua_istable(L, 1)) {
 		/*
 		 * The table is not empty and consists of tables
@@ -588,8 +775,7 @@ execute_call(lua_State *L, struct request *request, struct obuf *out)
 		int has_keys = lua_next(L, 1);
 		if (has_keys  && (lua_istable(L, -1) || lua_istuple(L, -1))) {
 			do {
-				luamp_encode_tuple(L, luaL_msgpack_default,
-						   out, -1);
+				call_encode_row(L, out, -1, true);
 				++count;
 				lua_pop(L, 1);
 			} while (lua_next(L, 1));
@@ -599,12 +785,7 @@ execute_call(lua_State *L, struct request *request, struct obuf *out)
 		}
 	}
 	for (int i = 1; i <= nrets; ++i) {
-		if (lua_istable(L, i) || lua_istuple(L, i)) {
-			luamp_encode_tuple(L, luaL_msgpack_default, out, i);
-		} else {
-			luamp_encode_array(luaL_msgpack_default, out, 1);
-			luamp_encode(L, luaL_msgpack_default, out, i);
-		}
+		call_encode_row(L, out, i, true);
 		++count;
 	}
 
@@ -617,9 +798,10 @@ box_lua_call(struct request *request, struct obuf *out)
 {
 	lua_State *L = NULL;
 	try {
-		L = lua_newthread(tarantool_L);
-		LuarefGuard coro_ref(tarantool_L);
+		LuaThreadGuard coro;
+		L = coro.L;
 		execute_call(L, request, out);
+		coro.release();
 	} catch (Exception *e) {
 		/* Let all well-behaved exceptions pass through. */
 		throw;
@@ -666,9 +848,10 @@ box_lua_eval(struct request *request, struct obuf *out)
 {
 	lua_State *L = NULL;
 	try {
-		L = lua_newthread(tarantool_L);
-		LuarefGuard coro_ref(tarantool_L);
+		LuaThreadGuard coro;
+		L = coro.L;
 		execute_eval(L, request, out);
+		coro.release();
 	} catch (Exception *e) {
 		/* Let all well-behaved exceptions pass through. */
 		throw;
@@ -700,6 +883,7 @@ static const struct luaL_reg boxlib[] = {
 static const struct luaL_reg boxlib_internal[] = {
 	{"process", lbox_process},
 	{"call_loadproc",  lbox_call_loadproc},
+	{"select", lbox_select},
 	{"insert", lbox_insert},
 	{"replace", lbox_replace},
 	{"update", lbox_update},
@@ -101,6 +101,40 @@ boxffi_index_get(uint32_t space_id, uint32_t index_id, const char *key)
 	}
 }
 
+int
+boxffi_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		      struct tuple **result)
+{
+	uint32_t count = mp_decode_array(&keys);
+	uint32_t i = 0;
+	try {
+		Index *index = check_index(space_id, index_id);
+		if (!index->key_def->is_unique)
+			tnt_raise(ClientError, ER_MORE_THAN_ONE_TUPLE);
+		const char *key = keys;
+		for (uint32_t k = 0; k < count; k++) {
+			assert(mp_typeof(*key) == MP_ARRAY); /* checked by Lua */
+			uint32_t part_count = mp_decode_array(&key);
+			primary_key_validate(index->key_def, key, part_count);
+			for (uint32_t part = 0; part < part_count; part++)
+				mp_next(&key);
+		}
+		index->findByKeys(keys, count, result);
+		for (; i < count; i++) {
+			if (result[i] != NULL)
+				tuple_ref(result[i]);
+		}
+		return 0;
+	} catch (Exception *) {
+		/* The tuples will be not blessed, avoid a leak. */
+		while (i-- > 0) {
+			if (result[i] != NULL)
+				tuple_unref(result[i]);
+		}
+		return -1; /* handled by box.error() in Lua */
+	}
+}
+
 static void
 box_index_init_iterator_types(struct lua_State *L, int idx)
 {
@@ -168,6 +202,29 @@ boxffi_iterator_next(struct iterator *itr)
 	}
 }
 
+/**
+ * boxffi_iterator_next() through the Lua C API, for engines
+ * which may yield while reading.
+ */
+static int
+lbox_iterator_next(struct lua_State *L)
+{
+	uint32_t ctypeid;
+	struct iterator *itr =
+		*(struct iterator **) luaL_checkcdata(L, 1, &ctypeid);
+	if (itr->sc_version != sc_version) {
+		Index *index = check_index(itr->space_id, itr->index_id);
+		if (index != itr->index || index->sc_version > itr->sc_version)
+			return 0; /* invalidate iterator */
+		itr->sc_version = sc_version;
+	}
+	struct tuple *tuple = itr->next(itr);
+	if (tuple == NULL)
+		return 0;
+	lbox_pushtuple(L, tuple);
+	return 1;
+}
+
 /* }}} */
 
 void
@@ -181,4 +238,11 @@ box_lua_index_init(struct lua_State *L)
 	luaL_register(L, "box.index", indexlib);
 	box_index_init_iterator_types(L, -2);
 	lua_pop(L, 1);
+
+	static const struct luaL_reg indexlib_internal [] = {
+		{"iterator_next", lbox_iterator_next},
+		{NULL, NULL}
+	};
+	luaL_register_module(L, "box.internal", indexlib_internal);
+	lua_pop(L, 1);
 }
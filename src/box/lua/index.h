@@ -51,6 +51,10 @@ boxffi_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd);
 struct tuple *
 boxffi_index_get(uint32_t space_id, uint32_t index_id, const char *key);
 
+int
+boxffi_index_get_many(uint32_t space_id, uint32_t index_id, const char *keys,
+		      struct tuple **result);
+
 struct iterator *
 boxffi_index_iterator(uint32_t space_id, uint32_t index_id, int type,
 		      const char *key);
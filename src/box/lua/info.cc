@@ -124,10 +124,15 @@ lbox_info_uptime(struct lua_State *L)
 	return 1;
 }
 
+/**
+ * Snapshots are written by a thread of the server, there is
+ * no snapshot process any more. The field is kept for the
+ * scripts which read it, and is always 0.
+ */
 static int
 lbox_info_snapshot_pid(struct lua_State *L)
 {
-	lua_pushnumber(L, snapshot_pid);
+	lua_pushnumber(L, 0);
 	return 1;
 }
 
@@ -42,6 +42,7 @@ local default_cfg = {
     io_collect_interval = nil,
     readahead           = 16320,
     snap_io_rate_limit  = nil, -- no limit
+    snap_compression    = nil, -- uncompressed
     too_long_threshold  = 0.5,
     wal_mode            = "write",
     rows_per_wal        = 500000,
@@ -87,6 +88,7 @@ local template_cfg = {
     io_collect_interval = 'number',
     readahead           = 'number',
     snap_io_rate_limit  = 'number',
+    snap_compression    = 'boolean',
     too_long_threshold  = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
@@ -28,6 +28,9 @@ ffi.cdef[[
     boxffi_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd);
     struct tuple *
     boxffi_index_get(uint32_t space_id, uint32_t index_id, const char *key);
+    int
+    boxffi_index_get_many(uint32_t space_id, uint32_t index_id,
+                          const char *keys, struct tuple **result);
     struct iterator *
     boxffi_index_iterator(uint32_t space_id, uint32_t index_id, int type,
                   const char *key);
@@ -558,6 +561,20 @@ local iterator_gen = function(param, state)
     end
 end
 
+-- Engines which yield while reading, such as sophia, can't be
+-- called through FFI: use the Lua C API instead
+local iterator_gen_luac = function(param, state)
+    if not ffi.istype(iterator_t, state) then
+        error('usage gen(param, state)')
+    end
+    local tuple = internal.iterator_next(state)
+    if tuple ~= nil then
+        return state, tuple -- new state, value
+    else
+        return nil
+    end
+end
+
 local iterator_cdata_gc = function(iterator)
     return iterator.free(iterator)
 end
@@ -580,8 +597,10 @@ local function space_object_check(space)
         end
 end
 
-function box.schema.space.bless(space)
+function box.schema.space.bless(space, yields)
     local index_mt = {}
+    -- yields is true unless the engine is ENGINE_NO_YIELD,
+    -- e.g. sophia reads from disk in a coeio thread
     -- __len and __index
     index_mt.len = function(index)
         local ret = builtin.boxffi_index_len(index.space_id, index.id)
@@ -662,7 +681,8 @@ function box.schema.space.bless(space)
             box.error()
         end
 
-        return fun.wrap(iterator_gen, keybuf, ffi.gc(cdata, iterator_cdata_gc))
+        return fun.wrap(yields and iterator_gen_luac or iterator_gen, keybuf,
+            ffi.gc(cdata, iterator_cdata_gc))
     end
     index_mt.__pairs = index_mt.pairs -- Lua 5.2 compatibility
     index_mt.__ipairs = index_mt.pairs -- Lua 5.2 compatibility
@@ -696,6 +716,10 @@ function box.schema.space.bless(space)
 
     index_mt.get = function(index, key)
         local key, key_end = msgpackffi.encode_tuple(key)
+        if yields then
+            return internal.select(index.space_id, index.id, box.index.EQ,
+                0, 1, ffi.string(key, key_end - key))[1]
+        end
         local tuple = builtin.boxffi_index_get(index.space_id, index.id, key)
         if tuple == ffi.cast('void *', -1) then
             return box.error() -- error
@@ -706,6 +730,34 @@ function box.schema.space.bless(space)
         end
     end
 
+    index_mt.get_many = function(index, keys)
+        local count = #keys
+        if yields then
+            local ret = {}
+            for i = 1, count do
+                ret[i] = index:get(keys[i])
+            end
+            return ret
+        end
+        local tuple_keys = {}
+        for i = 1, count do
+            tuple_keys[i] = keify(keys[i])
+        end
+        local key = msgpackffi.encode_tuple(tuple_keys)
+        local result = ffi.new('struct tuple *[?]', count)
+        if builtin.boxffi_index_get_many(index.space_id, index.id,
+                                         key, result) ~= 0 then
+            return box.error()
+        end
+        local ret = {}
+        for i = 0, count - 1 do
+            if result[i] ~= nil then
+                ret[i + 1] = box.tuple.bless(result[i])
+            end
+        end
+        return ret
+    end
+
     index_mt.select = function(index, key, opts)
         local offset = 0
         local limit = 4294967295
@@ -735,6 +787,11 @@ function box.schema.space.bless(space)
             end
         end
 
+        if yields then
+            return internal.select(index.space_id, index.id, iterator,
+                offset, limit, ffi.string(key, key_end - key))
+        end
+
         if builtin.boxffi_select(port, index.space_id,
             index.id, iterator, offset, limit, key, key_end) ~=0 then
             return box.error()
@@ -780,6 +837,10 @@ function box.schema.space.bless(space)
         check_index(space, 0)
         return space.index[0]:get(key)
     end
+    space_mt.get_many = function(space, keys)
+        check_index(space, 0)
+        return space.index[0]:get_many(keys)
+    end
     space_mt.select = function(space, key, opts)
         check_index(space, 0)
         return space.index[0]:select(key, opts)
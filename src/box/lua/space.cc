@@ -209,7 +209,9 @@ lbox_fillspace(struct lua_State *L, struct space *space, int i)
 	lua_gettable(L, -2);
 
 	lua_pushvalue(L, i);	/* space */
-	lua_call(L, 1, 0);
+	/* Reads of a disk engine yield, e.g. sophia's. */
+	lua_pushboolean(L, ! engine_no_yield(space->handler->engine->flags));
+	lua_call(L, 2, 0);
 	lua_pop(L, 3);	/* cleanup stack - box, schema, space */
 }
 
@@ -39,6 +39,10 @@ extern "C" {
 } /* extern "C" */
 
 #include "lua/utils.h"
+#include "box/space.h"
+#include "box/schema.h"
+#include "box/request.h"
+#include "box/txn.h"
 
 static void
 fill_stat_item(struct lua_State *L, int rps, int64_t total)
@@ -99,6 +103,74 @@ lbox_stat_call(struct lua_State *L)
 	return 1;
 }
 
+static void
+fill_latency_item(struct lua_State *L, const struct histogram *h)
+{
+	static const struct {
+		const char *name;
+		double percent;
+	} percentiles[] = {
+		{"p50", 50}, {"p90", 90}, {"p99", 99}, {"p999", 99.9}
+	};
+	lua_newtable(L);
+
+	lua_pushstring(L, "count");
+	lua_pushnumber(L, h->count);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "avg");
+	lua_pushnumber(L, h->count ? h->sum / 1e9 / h->count : 0);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "max");
+	lua_pushnumber(L, h->max / 1e9);
+	lua_settable(L, -3);
+
+	for (unsigned i = 0; i < lengthof(percentiles); i++) {
+		lua_pushstring(L, percentiles[i].name);
+		lua_pushnumber(L, histogram_percentile(h,
+			percentiles[i].percent) / 1e9);
+		lua_settable(L, -3);
+	}
+}
+
+static void
+set_space_latency_item(struct space *space, void *udata)
+{
+	struct lua_State *L = (struct lua_State *) udata;
+	if (space->latency.count == 0)
+		return;
+	lua_pushstring(L, space_name(space));
+	fill_latency_item(L, &space->latency);
+	lua_settable(L, -3);
+}
+
+/**
+ * box.stat.latency(): request execution time distribution,
+ * by request type, for WAL writes and per space, in seconds.
+ */
+static int
+lbox_stat_latency(struct lua_State *L)
+{
+	lua_newtable(L);
+	for (int i = 0; i < IPROTO_TYPE_STAT_MAX; i++) {
+		if (iproto_type_strs[i] == NULL)
+			continue;
+		lua_pushstring(L, iproto_type_strs[i]);
+		fill_latency_item(L, &latency_request[i]);
+		lua_settable(L, -3);
+	}
+	lua_pushstring(L, "WAL");
+	fill_latency_item(L, &latency_wal);
+	lua_settable(L, -3);
+
+	lua_pushstring(L, "space");
+	lua_newtable(L);
+	space_foreach(set_space_latency_item, L);
+	lua_settable(L, -3);
+	return 1;
+}
+
 static const struct luaL_reg lbox_stat_meta [] = {
 	{"__index", lbox_stat_index},
 	{"__call",  lbox_stat_call},
@@ -110,6 +182,7 @@ void
 box_lua_stat_init(struct lua_State *L)
 {
 	static const struct luaL_reg statlib [] = {
+		{"latency", lbox_stat_latency},
 		{NULL, NULL}
 	};
 
@@ -55,9 +55,15 @@ value_to_tuple(size_t value)
 	/* return (struct tuple *) salloc_ptr_from_index(value); */
 	return (struct tuple *) (value << 2);
 }
+enum { BITSET_ITERATOR_BATCH = 64 };
+
 struct bitset_index_iterator {
 	struct iterator base; /* Must be the first member. */
 	struct bitset_iterator bitset_it;
+	/* Positions fetched from bitset_it but not yet returned. */
+	size_t batch[BITSET_ITERATOR_BATCH];
+	uint32_t batch_pos;
+	uint32_t batch_size;
 };
 
 static struct bitset_index_iterator *
@@ -82,11 +88,16 @@ bitset_index_iterator_next(struct iterator *iterator)
 	assert(iterator->free == bitset_index_iterator_free);
 	struct bitset_index_iterator *it = bitset_index_iterator(iterator);
 
-	size_t value = bitset_iterator_next(&it->bitset_it);
-	if (value == SIZE_MAX)
-		return NULL;
+	if (it->batch_pos == it->batch_size) {
+		it->batch_size = bitset_iterator_next_batch(&it->bitset_it,
+							    it->batch,
+							    BITSET_ITERATOR_BATCH);
+		it->batch_pos = 0;
+		if (it->batch_size == 0)
+			return NULL;
+	}
 
-	return value_to_tuple(value);
+	return value_to_tuple(it->batch[it->batch_pos++]);
 }
 
 MemtxBitset::MemtxBitset(struct key_def *key_def)
@@ -205,6 +216,7 @@ MemtxBitset::initIterator(struct iterator *iterator, enum iterator_type type,
 	(void) part_count;
 
 	struct bitset_index_iterator *it = bitset_index_iterator(iterator);
+	it->batch_pos = it->batch_size = 0;
 
 	const void *bitset_key = NULL;
 	uint32_t bitset_key_size = 0;
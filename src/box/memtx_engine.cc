@@ -46,6 +46,11 @@
 #include "tarantool.h"
 #include "coeio_file.h"
 #include "coio.h"
+#include "coeio.h"
+#include "fio.h"
+#include "assoc.h"
+#include "tt_pthread.h"
+#include "scoped_guard.h"
 #include "errinj.h"
 
 /** For all memory used by all indexes. */
@@ -91,7 +96,7 @@ memtx_recovery_prepare(struct engine_recovery *r)
 MemtxEngine::MemtxEngine()
 	:Engine("memtx"),
 	m_snapshot_lsn(-1),
-	m_snapshot_pid(0)
+	m_checkpoint(NULL)
 {
 	flags = ENGINE_NO_YIELD |
 	        ENGINE_CAN_BE_TEMPORARY |
@@ -137,6 +142,9 @@ MemtxEngine::createIndex(struct key_def *key_def)
 void
 MemtxEngine::dropIndex(Index *index)
 {
+	/* Tuples are owned by the primary key. */
+	if (index->key_def->iid != 0)
+		return;
 	struct iterator *it = index->position();
 	index->initIterator(it, ITER_ALL, NULL, 0);
 	struct tuple *tuple;
@@ -250,69 +258,57 @@ struct request_replace_body {
 	uint8_t k_tuple;
 } __attribute__((packed));
 
+/** Bytes written since the last throttling of the snapshot writer. */
+static uint64_t snapshot_bytes;
+/** Time of the last throttling of the snapshot writer. */
+static ev_tstamp snapshot_last;
+
+/**
+ * Write all rows of the batch to the snapshot and throttle
+ * the writer according to the I/O rate limit.
+ */
 static void
-snapshot_write_row(struct recovery_state *r, struct xlog *l,
-		   struct xrow_header *row)
+snapshot_write_batch(struct recovery_state *r, struct xlog *l,
+		     struct fio_batch *batch)
 {
-	static uint64_t bytes;
 	ev_tstamp elapsed;
-	static ev_tstamp last = 0;
 	ev_loop *loop = loop();
 
-	row->tm = last;
-	row->server_id = 0;
-	/**
-	 * Rows in snapshot are numbered from 1 to %rows.
-	 * This makes streaming such rows to a replica or
-	 * to recovery look similar to streaming a normal
-	 * WAL. @sa the place which skips old rows in
-	 * recovery_apply_row().
-	 */
-	row->lsn = ++l->rows;
-	row->sync = 0; /* don't write sync to wal */
-
-	struct iovec iov[XROW_IOVMAX];
-	int iovcnt = xlog_encode_row(row, iov);
-
-	/* TODO: use writev here */
-	for (int i = 0; i < iovcnt; i++) {
-		if (fwrite(iov[i].iov_base, iov[i].iov_len, 1, l->f) != 1) {
-			say_error("Can't write row (%zu bytes)",
-				  iov[i].iov_len);
-			panic_syserror("snapshot_write_row");
-		}
-		bytes += iov[i].iov_len;
+	if (batch->rows == 0)
+		return;
+	if (fio_batch_write(batch, fileno(l->f)) != batch->rows) {
+		tnt_raise(SystemError, "Can't write %d rows (%zd bytes)",
+			  batch->rows, batch->bytes);
 	}
+	snapshot_bytes += batch->bytes;
 
-	if (l->rows % 100000 == 0)
-		say_crit("%.1fM rows written", l->rows / 1000000.);
-
+	fio_batch_start(batch, LONG_MAX);
 	fiber_gc();
 
 	if (r->snap_io_rate_limit != UINT64_MAX) {
-		if (last == 0) {
+		if (snapshot_last == 0) {
 			/*
 			 * Remember the time of first
 			 * write to disk.
 			 */
 			ev_now_update(loop);
-			last = ev_now(loop);
+			snapshot_last = ev_now(loop);
 		}
 		/**
 		 * If io rate limit is set, flush the
 		 * filesystem cache, otherwise the limit is
 		 * not really enforced.
 		 */
-		if (bytes > r->snap_io_rate_limit)
+		if (snapshot_bytes > r->snap_io_rate_limit)
 			fdatasync(fileno(l->f));
 	}
-	while (bytes > r->snap_io_rate_limit) {
+	while (snapshot_bytes > r->snap_io_rate_limit) {
 		ev_now_update(loop);
 		/*
 		 * How much time have passed since
 		 * last write?
 		 */
-		elapsed = ev_now(loop) - last;
+		elapsed = ev_now(loop) - snapshot_last;
 		/*
 		 * If last write was in less than
 		 * a second, sleep until the
@@ -322,59 +318,323 @@ snapshot_write_row(struct recovery_state *r, struct xlog *l,
 			usleep(((1 - elapsed) * 1000000));
 
 		ev_now_update(loop);
-		last = ev_now(loop);
-		bytes -= r->snap_io_rate_limit;
+		snapshot_last = ev_now(loop);
+		snapshot_bytes -= r->snap_io_rate_limit;
+	}
+}
+
+/**
+ * Compress the rows accumulated in the block and write the
+ * result out. A block is large enough to be written with
+ * a write() of its own.
+ */
+static void
+snapshot_write_block(struct recovery_state *r, struct xlog *l,
+		     struct fio_batch *batch, struct xlog_block *block)
+{
+	if (block->size == 0)
+		return;
+	struct iovec iov[1];
+	int iovcnt = xlog_encode_block(block, iov);
+	fio_batch_add(batch, iov, iovcnt);
+	snapshot_write_batch(r, l, batch);
+}
+
+/**
+ * Add a row to the batch. Rows are written with one writev()
+ * per batch rather than one write() per row chunk. If the
+ * snapshot is compressed, the row goes to the block first.
+ * The batch must have space for the row.
+ */
+static void
+snapshot_write_row(struct recovery_state *r, struct xlog *l,
+		   struct fio_batch *batch, struct xlog_block *block,
+		   struct xrow_header *row)
+{
+	struct iovec iov[XROW_IOVMAX];
+
+	row->tm = snapshot_last;
+	row->server_id = 0;
+	/**
+	 * Rows in snapshot are numbered from 1 to %rows.
+	 * This makes streaming such rows to a replica or
+	 * to recovery look similar to streaming a normal
+	 * WAL. @sa the place which skips old rows in
+	 * recovery_apply_row().
+	 */
+	row->lsn = ++l->rows;
+	row->sync = 0; /* don't write sync to wal */
+
+	int iovcnt = xlog_encode_row(row, iov);
+	if (block != NULL) {
+		xlog_block_add(block, iov, iovcnt);
+		if (block->size >= XLOG_BLOCK_SIZE)
+			snapshot_write_block(r, l, batch, block);
+	} else {
+		fio_batch_add(batch, iov, iovcnt);
 	}
+	if (l->rows % 100000 == 0)
+		say_crit("%.1fM rows written", l->rows / 1000000.);
 }
 
 static void
-snapshot_write_tuple(struct xlog *l,
-		     uint32_t n, struct tuple *tuple)
+snapshot_write_tuple(struct xlog *l, struct fio_batch *batch,
+		     struct xlog_block *block, uint32_t n, struct tuple *tuple)
 {
-	struct request_replace_body body;
-	body.m_body = 0x82; /* map of two elements. */
-	body.k_space_id = IPROTO_SPACE_ID;
-	body.m_space_id = 0xce; /* uint32 */
-	body.v_space_id = mp_bswap_u32(n);
-	body.k_tuple = IPROTO_TUPLE;
+	/*
+	 * Write the batch out if it's full before allocating
+	 * the row: the region is freed after each write.
+	 */
+	if (block == NULL && fio_batch_has_space(batch, XROW_IOVMAX))
+		snapshot_write_batch(recovery, l, batch);
+	/* Must live until the batch is written. */
+	struct request_replace_body *body = (struct request_replace_body *)
+		region_alloc(&fiber()->gc, sizeof(*body));
+	body->m_body = 0x82; /* map of two elements. */
+	body->k_space_id = IPROTO_SPACE_ID;
+	body->m_space_id = 0xce; /* uint32 */
+	body->v_space_id = mp_bswap_u32(n);
+	body->k_tuple = IPROTO_TUPLE;
 
 	struct xrow_header row;
 	memset(&row, 0, sizeof(struct xrow_header));
 	row.type = IPROTO_INSERT;
 
 	row.bodycnt = 2;
-	row.body[0].iov_base = &body;
-	row.body[0].iov_len = sizeof(body);
+	row.body[0].iov_base = body;
+	row.body[0].iov_len = sizeof(*body);
 	row.body[1].iov_base = tuple->data;
 	row.body[1].iov_len = tuple->bsize;
-	snapshot_write_row(recovery, l, &row);
+	snapshot_write_row(recovery, l, batch, block, &row);
+}
+
+enum {
+	/** Tuples in a chunk of a checkpoint. */
+	CHECKPOINT_CHUNK_SIZE = 16 * 1024,
+	/** Tuples copied between yields of a checkpoint copy. */
+	CHECKPOINT_COPY_YIELD = 10000,
+};
+
+/** A tuple to write to a checkpoint. */
+struct checkpoint_row {
+	uint32_t space_id;
+	struct tuple *tuple;
+};
+
+/**
+ * Rows passed from tx to the checkpoint thread, which
+ * writes and frees them.
+ */
+struct checkpoint_chunk {
+	struct rlist link;
+	uint32_t count;
+	struct checkpoint_row rows[CHECKPOINT_CHUNK_SIZE];
+};
+
+/**
+ * A space to write to a checkpoint. Its primary key is copied
+ * by tx in portions, between yields. A tuple which existed
+ * when the checkpoint started and is removed from the key
+ * before the copy has passed it, is saved in the space's
+ * @a removed list, see memtx_checkpoint_replace().
+ */
+struct checkpoint_space {
+	uint32_t id;
+	/** The copy of the space is complete. */
+	bool done;
+	/** The last tuple copied, if the copy has yielded. */
+	struct tuple *last;
+	/** Tuples removed before the copy got to them. */
+	struct tuple **removed;
+	uint32_t removed_count;
+	uint32_t removed_alloc;
+};
+
+/**
+ * A memtx checkpoint. Its contents are tuples which existed
+ * when it started. Such tuples stay valid until the
+ * checkpoint ends: they are freed in delayed mode, see
+ * tuple_begin_snapshot(). Tuples created after the start
+ * carry the new snapshot_version and are skipped.
+ */
+struct checkpoint {
+	struct cord cord;
+	/** Vclock of the checkpoint, defines the file name. */
+	struct vclock vclock;
+	/** Spaces to write, in the order of space_foreach(). */
+	struct checkpoint_space *spaces;
+	uint32_t space_count;
+	uint32_t space_alloc;
+	/** Space id -> struct checkpoint_space. */
+	struct mh_i32ptr_t *space_map;
+	/** The chunk being filled by tx. */
+	struct checkpoint_chunk *chunk;
+	/** Chunks ready to be written, protected by mutex. */
+	struct rlist chunks;
+	/** No more chunks will come. */
+	bool is_eof;
+	/** The checkpoint thread has stopped on error. */
+	bool is_failed;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+/** The checkpoint being copied by tx, if any. */
+static struct checkpoint *checkpoint_copy;
+
+static void
+checkpoint_delete(struct checkpoint *ckpt)
+{
+	for (uint32_t i = 0; i < ckpt->space_count; i++)
+		free(ckpt->spaces[i].removed);
+	free(ckpt->spaces);
+	if (ckpt->space_map != NULL)
+		mh_i32ptr_delete(ckpt->space_map);
+	struct checkpoint_chunk *chunk, *tmp;
+	rlist_foreach_entry_safe(chunk, &ckpt->chunks, link, tmp)
+		free(chunk);
+	free(ckpt->chunk);
+	tt_pthread_cond_destroy(&ckpt->cond);
+	tt_pthread_mutex_destroy(&ckpt->mutex);
+	free(ckpt);
+}
+
+/** Pass the chunk filled by tx to the checkpoint thread. */
+static void
+checkpoint_flush_chunk(struct checkpoint *ckpt)
+{
+	if (ckpt->chunk == NULL || ckpt->chunk->count == 0)
+		return;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	rlist_add_tail_entry(&ckpt->chunks, ckpt->chunk, link);
+	tt_pthread_cond_signal(&ckpt->cond);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
+	ckpt->chunk = NULL;
 }
 
 static void
-snapshot_space(struct space *sp, void *udata)
+checkpoint_add_row(struct checkpoint *ckpt, uint32_t space_id,
+		   struct tuple *tuple)
+{
+	if (ckpt->chunk == NULL) {
+		ckpt->chunk = (struct checkpoint_chunk *)
+			malloc(sizeof(*ckpt->chunk));
+		if (ckpt->chunk == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*ckpt->chunk),
+				  "malloc", "struct checkpoint_chunk");
+		}
+		ckpt->chunk->count = 0;
+	}
+	struct checkpoint_row *row = &ckpt->chunk->rows[ckpt->chunk->count++];
+	row->space_id = space_id;
+	row->tuple = tuple;
+	if (ckpt->chunk->count == CHECKPOINT_CHUNK_SIZE)
+		checkpoint_flush_chunk(ckpt);
+}
+
+/** Remember a space to write it to the checkpoint. */
+static void
+checkpoint_add_space(struct space *sp, void *udata)
 {
 	if (space_is_temporary(sp))
 		return;
 	if (space_is_sophia(sp))
 		return;
-	struct tuple *tuple;
-	struct xlog *l = (struct xlog *)udata;
-	Index *pk = space_index(sp, 0);
-	if (pk == NULL)
+	struct checkpoint *ckpt = (struct checkpoint *) udata;
+	if (space_index(sp, 0) == NULL)
 		return;
-	struct iterator *it = pk->position();
-	pk->initIterator(it, ITER_ALL, NULL, 0);
+	if (ckpt->space_count == ckpt->space_alloc) {
+		uint32_t space_alloc = MAX(ckpt->space_alloc * 2, 64);
+		struct checkpoint_space *spaces = (struct checkpoint_space *)
+			realloc(ckpt->spaces, space_alloc * sizeof(*spaces));
+		if (spaces == NULL) {
+			tnt_raise(OutOfMemory, space_alloc * sizeof(*spaces),
+				  "malloc", "struct checkpoint_space");
+		}
+		ckpt->spaces = spaces;
+		ckpt->space_alloc = space_alloc;
+	}
+	struct checkpoint_space *cs = &ckpt->spaces[ckpt->space_count++];
+	memset(cs, 0, sizeof(*cs));
+	cs->id = space_id(sp);
+}
 
-	while ((tuple = it->next(it)))
-		snapshot_write_tuple(l, space_id(sp), tuple);
+static struct checkpoint_space *
+checkpoint_find_space(struct checkpoint *ckpt, uint32_t id)
+{
+	mh_int_t k = mh_i32ptr_find(ckpt->space_map, id, NULL);
+	if (k == mh_end(ckpt->space_map))
+		return NULL;
+	return (struct checkpoint_space *)
+		mh_i32ptr_node(ckpt->space_map, k)->val;
 }
 
+/**
+ * Copy the rest of the space to the checkpoint. If the primary
+ * key is a TREE, the copy yields every CHECKPOINT_COPY_YIELD
+ * tuples, unless the caller can't yield. Tuples removed from
+ * the space meanwhile are collected in cs->removed.
+ */
 static void
-snapshot_save(struct recovery_state *r)
+checkpoint_copy_space(struct checkpoint *ckpt, struct checkpoint_space *cs,
+		      bool can_yield)
+{
+	assert(! cs->done);
+	struct space *sp = space_cache_find(cs->id);
+	Index *pk = index_find(sp, 0);
+	struct iterator *it = pk->allocIterator();
+	auto it_guard = make_scoped_guard([=]{ it->free(it); });
+	if (cs->last == NULL)
+		pk->initIterator(it, ITER_ALL, NULL, 0);
+	else
+		index_seek_after(pk, it, cs->last);
+	can_yield = can_yield && pk->key_def->type == TREE;
+	struct tuple *tuple;
+	uint32_t count = 0;
+	while ((tuple = it->next(it))) {
+		/* Created after the start of the checkpoint. */
+		if (tuple->version == snapshot_version)
+			continue;
+		checkpoint_add_row(ckpt, cs->id, tuple);
+		if (! can_yield || ++count % CHECKPOINT_COPY_YIELD != 0)
+			continue;
+		cs->last = tuple;
+		fiber_sleep(0);
+		/*
+		 * The space could only change its definition
+		 * once memtx_checkpoint_copy_space() has
+		 * finished the copy.
+		 */
+		if (cs->done)
+			return;
+		index_seek_after(pk, it, cs->last);
+	}
+	for (uint32_t i = 0; i < cs->removed_count; i++)
+		checkpoint_add_row(ckpt, cs->id, cs->removed[i]);
+	cs->done = true;
+}
+
+/**
+ * Write rows passed by tx until the end of the copy.
+ */
+static void *
+checkpoint_f(void *arg)
 {
-	struct xlog *snap = xlog_create(&r->snap_dir, &r->vclock);
+	struct checkpoint *ckpt = (struct checkpoint *) arg;
+	auto fail_guard = make_scoped_guard([=]{
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		ckpt->is_failed = true;
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+	});
+	struct xlog *snap = xlog_create(&recovery->snap_dir, &ckpt->vclock);
 	if (snap == NULL)
-		panic_status(errno, "failed to save snapshot: failed to open file in write mode.");
+		tnt_raise(SystemError, "failed to save snapshot: "
+			  "failed to open file in write mode.");
+	auto guard = make_scoped_guard([=]{
+		/** suppress rename */
+		snap->is_inprogress = false;
+		xlog_close(snap);
+	});
 	/*
 	 * While saving a snapshot, snapshot name is set to
 	 * <lsn>.snap.inprogress. When done, the snapshot is
@@ -382,56 +642,193 @@ snapshot_save(struct recovery_state *r)
 	 */
 	say_info("saving snapshot `%s'", snap->filename);
 
-	space_foreach(snapshot_space, snap);
+	struct fio_batch *batch = fio_batch_alloc(sysconf(_SC_IOV_MAX));
+	if (batch == NULL)
+		tnt_raise(SystemError, "fio_batch_alloc");
+	auto batch_guard = make_scoped_guard([=]{ free(batch); });
+	fio_batch_start(batch, LONG_MAX);
 
-	/** suppress rename */
-	snap->is_inprogress = false;
-	xlog_close(snap);
+	struct xlog_block block_buf, *block = NULL;
+	if (snap->dir->compress) {
+		xlog_block_create(&block_buf);
+		block = &block_buf;
+	}
+	auto block_guard = make_scoped_guard([=]{
+		if (block != NULL)
+			xlog_block_destroy(block);
+	});
+
+	while (true) {
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		while (rlist_empty(&ckpt->chunks) && ! ckpt->is_eof)
+			tt_pthread_cond_wait(&ckpt->cond, &ckpt->mutex);
+		struct checkpoint_chunk *chunk = NULL;
+		if (! rlist_empty(&ckpt->chunks)) {
+			chunk = rlist_shift_entry(&ckpt->chunks,
+						  struct checkpoint_chunk,
+						  link);
+		}
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+		if (chunk == NULL)
+			break;
+		auto chunk_guard = make_scoped_guard([=]{ free(chunk); });
+		for (uint32_t i = 0; i < chunk->count; i++) {
+			snapshot_write_tuple(snap, batch, block,
+					     chunk->rows[i].space_id,
+					     chunk->rows[i].tuple);
+		}
+	}
+	if (block != NULL)
+		snapshot_write_block(recovery, snap, batch, block);
+	snapshot_write_batch(recovery, snap, batch);
 
+	fail_guard.is_active = false;
 	say_info("done");
+	return NULL;
+}
+
+void
+memtx_checkpoint_replace(struct space *space, struct tuple *old_tuple,
+			 struct tuple *new_tuple)
+{
+	struct checkpoint *ckpt = checkpoint_copy;
+	if (ckpt == NULL)
+		return;
+	struct checkpoint_space *cs = checkpoint_find_space(ckpt,
+							    space_id(space));
+	if (cs == NULL || cs->done)
+		return;
+	struct key_def *key_def = space->index[0]->key_def;
+	/*
+	 * A tuple which existed at the start of the checkpoint
+	 * has been removed, and the copy hasn't got to it yet.
+	 */
+	if (old_tuple != NULL && old_tuple->version != snapshot_version &&
+	    (cs->last == NULL ||
+	     tuple_compare(old_tuple, cs->last, key_def) > 0)) {
+		if (cs->removed_count == cs->removed_alloc) {
+			uint32_t removed_alloc = MAX(cs->removed_alloc * 2, 64);
+			struct tuple **removed = (struct tuple **)
+				realloc(cs->removed,
+					removed_alloc * sizeof(*removed));
+			if (removed == NULL) {
+				tnt_raise(OutOfMemory,
+					  removed_alloc * sizeof(*removed),
+					  "malloc", "struct checkpoint_space");
+			}
+			cs->removed = removed;
+			cs->removed_alloc = removed_alloc;
+		}
+		cs->removed[cs->removed_count++] = old_tuple;
+	}
+	/*
+	 * A rollback has put a removed tuple back, the copy
+	 * will find it in the key.
+	 */
+	if (new_tuple != NULL && new_tuple->version != snapshot_version &&
+	    (cs->last == NULL ||
+	     tuple_compare(new_tuple, cs->last, key_def) > 0)) {
+		for (uint32_t i = cs->removed_count; i > 0; i--) {
+			if (cs->removed[i - 1] != new_tuple)
+				continue;
+			cs->removed[i - 1] = cs->removed[--cs->removed_count];
+			break;
+		}
+	}
+}
+
+void
+memtx_checkpoint_copy_space(struct space *space)
+{
+	struct checkpoint *ckpt = checkpoint_copy;
+	if (ckpt == NULL)
+		return;
+	struct checkpoint_space *cs = checkpoint_find_space(ckpt,
+							    space_id(space));
+	if (cs == NULL || cs->done)
+		return;
+	checkpoint_copy_space(ckpt, cs, false);
+}
+
+/**
+ * Copy all spaces to the checkpoint thread, yielding
+ * along the way.
+ */
+static void
+checkpoint_copy_all(struct checkpoint *ckpt)
+{
+	for (uint32_t i = 0; i < ckpt->space_count; i++) {
+		struct checkpoint_space *cs = &ckpt->spaces[i];
+		tt_pthread_mutex_lock(&ckpt->mutex);
+		bool is_failed = ckpt->is_failed;
+		tt_pthread_mutex_unlock(&ckpt->mutex);
+		if (is_failed)
+			break;
+		if (! cs->done)
+			checkpoint_copy_space(ckpt, cs, true);
+	}
+	checkpoint_flush_chunk(ckpt);
+}
+
+/** Tell the checkpoint thread there is no more rows. */
+static void
+checkpoint_end_copy(struct checkpoint *ckpt)
+{
+	checkpoint_copy = NULL;
+	tt_pthread_mutex_lock(&ckpt->mutex);
+	ckpt->is_eof = true;
+	tt_pthread_cond_signal(&ckpt->cond);
+	tt_pthread_mutex_unlock(&ckpt->mutex);
 }
 
 int
 MemtxEngine::begin_checkpoint(int64_t lsn)
 {
 	assert(m_snapshot_lsn == -1);
-	assert(m_snapshot_pid == 0);
-	/* flush buffers to avoid multiple output
-	 *
-	 * https://github.com/tarantool/tarantool/issues/366
-	*/
-	fflush(stdout);
-	fflush(stderr);
-	/*
-	 * Due to fork nature, no threads are recreated.
-	 * This is the only consistency guarantee here for a
-	 * multi-threaded engine.
-	 */
-	snapshot_pid = fork();
-	switch (snapshot_pid) {
-	case -1:
-		say_syserror("fork");
+	assert(m_checkpoint == NULL);
+
+	struct checkpoint *ckpt = (struct checkpoint *)
+		calloc(1, sizeof(*ckpt));
+	if (ckpt == NULL) {
+		say_syserror("calloc");
 		return -1;
-	case  0: /* dumper */
-		slab_arena_mprotect(&memtx_arena);
-		cord_set_name("snap");
-		title("dumper", "%" PRIu32, getppid());
-		fiber_set_name(fiber(), "dumper");
-		/* make sure we don't double-write parent stdio
-		 * buffers at exit() during panic */
-		close_all_xcpt(1, log_fd);
-		/* do not rename snapshot */
-		snapshot_save(::recovery);
-		exit(EXIT_SUCCESS);
-		return 0;
-	default: /* waiter */
-		break;
 	}
-
-	m_snapshot_lsn = lsn;
-	m_snapshot_pid = snapshot_pid;
-	/* increment snapshot version */
+	rlist_create(&ckpt->chunks);
+	tt_pthread_mutex_init(&ckpt->mutex, NULL);
+	tt_pthread_cond_init(&ckpt->cond, NULL);
+	ckpt->space_map = mh_i32ptr_new();
+	vclock_copy(&ckpt->vclock, &::recovery->vclock);
+	try {
+		if (ckpt->space_map == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*ckpt->space_map),
+				  "malloc", "struct checkpoint");
+		}
+		space_foreach(checkpoint_add_space, ckpt);
+		for (uint32_t i = 0; i < ckpt->space_count; i++) {
+			const struct mh_i32ptr_node_t node =
+				{ ckpt->spaces[i].id, &ckpt->spaces[i] };
+			if (mh_i32ptr_put(ckpt->space_map, &node, NULL,
+					  NULL) == mh_end(ckpt->space_map)) {
+				tnt_raise(OutOfMemory, sizeof(node),
+					  "malloc", "struct checkpoint");
+			}
+		}
+	} catch (Exception *e) {
+		e->log();
+		checkpoint_delete(ckpt);
+		errno = ENOMEM;
+		return -1;
+	}
+	/*
+	 * Tuples deleted from now on are only freed when the
+	 * checkpoint ends. The spaces are copied in
+	 * wait_checkpoint(), changes made since now are
+	 * tracked by memtx_checkpoint_replace().
+	 */
 	tuple_begin_snapshot();
+	checkpoint_copy = ckpt;
+	m_snapshot_lsn = lsn;
+	m_checkpoint = ckpt;
 	return 0;
 }
 
@@ -439,16 +836,38 @@ int
 MemtxEngine::wait_checkpoint()
 {
 	assert(m_snapshot_lsn >= 0);
-	assert(m_snapshot_pid > 0);
+	assert(m_checkpoint != NULL);
+	struct checkpoint *ckpt = m_checkpoint;
+	int rc = 0;
+	if (cord_start(&ckpt->cord, "snapshot", checkpoint_f, ckpt)) {
+		say_syserror("failed to start the snapshot thread");
+		rc = errno;
+		checkpoint_end_copy(ckpt);
+		goto end;
+	}
+	try {
+		checkpoint_copy_all(ckpt);
+	} catch (Exception *e) {
+		e->log();
+		rc = ENOMEM;
+	}
+	checkpoint_end_copy(ckpt);
 	/* wait for memtx-part snapshot completion */
-	int rc = coio_waitpid(m_snapshot_pid);
-	if (WIFSIGNALED(rc))
-		rc = EINTR;
-	else
-		rc = WEXITSTATUS(rc);
+	try {
+		if (cord_cojoin(&ckpt->cord) != 0 && rc == 0)
+			rc = EINTR;
+	} catch (SystemError *e) {
+		e->log();
+		rc = e->errnum() ? e->errnum() : EIO;
+	} catch (Exception *e) {
+		e->log();
+		rc = EIO;
+	}
+end:
 	/* complete snapshot */
 	tuple_end_snapshot();
-	m_snapshot_pid = snapshot_pid = 0;
+	checkpoint_delete(ckpt);
+	m_checkpoint = NULL;
 	errno = rc;
 
 	return rc;
@@ -460,7 +879,7 @@ MemtxEngine::commit_checkpoint()
 	/* begin_checkpoint() must have been done */
 	assert(m_snapshot_lsn >= 0);
 	/* wait_checkpoint() must have been done. */
-	assert(m_snapshot_pid == 0);
+	assert(m_checkpoint == NULL);
 
 	struct xdir *dir = &::recovery->snap_dir;
 	/* rename snapshot on completion */
@@ -478,12 +897,16 @@ MemtxEngine::commit_checkpoint()
 void
 MemtxEngine::abort_checkpoint()
 {
-	if (m_snapshot_pid > 0) {
+	if (m_checkpoint != NULL) {
 		assert(m_snapshot_lsn >= 0);
 		/**
-		 * An error in the other engine's first phase.
+		 * An error in the other engine's first phase,
+		 * the copy hasn't started.
 		 */
-		wait_checkpoint();
+		checkpoint_copy = NULL;
+		tuple_end_snapshot();
+		checkpoint_delete(m_checkpoint);
+		m_checkpoint = NULL;
 	}
 	if (m_snapshot_lsn > 0) {
 		/** Remove garbage .inprogress file. */
@@ -30,6 +30,8 @@
  */
 #include "engine.h"
 
+struct checkpoint;
+
 struct MemtxEngine: public Engine {
 	MemtxEngine();
 	virtual Handler *open();
@@ -49,9 +51,27 @@ private:
 	 * LSN of the snapshot which is in progress.
 	 */
 	int64_t m_snapshot_lsn;
-	pid_t m_snapshot_pid;
+	/** The checkpoint being written, if any. */
+	struct checkpoint *m_checkpoint;
 };
 
+/**
+ * Keep the checkpoint in progress, if any, consistent with a
+ * change of a space: a tuple removed from the primary key before
+ * the checkpoint has copied it is still written to the
+ * checkpoint. Called after the change is applied to the indexes.
+ */
+void
+memtx_checkpoint_replace(struct space *space, struct tuple *old_tuple,
+			 struct tuple *new_tuple);
+
+/**
+ * Finish the copy of the space to the checkpoint in progress,
+ * if any, before the space definition is changed.
+ */
+void
+memtx_checkpoint_copy_space(struct space *space);
+
 enum {
 	MEMTX_EXTENT_SIZE = 16 * 1024,
 	MEMTX_SLAB_SIZE = 4 * 1024 * 1024
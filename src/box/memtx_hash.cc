@@ -35,7 +35,9 @@
 #include "third_party/PMurHash.h"
 
 enum {
-	HASH_SEED = 13U
+	HASH_SEED = 13U,
+	/** Number of keys probed together by findByKeys(). */
+	HASH_PROBE_BATCH = 16
 };
 
 static inline bool
@@ -260,6 +262,41 @@ MemtxHash::findByKey(const char *key, uint32_t part_count) const
 	return ret;
 }
 
+void
+MemtxHash::findByKeys(const char *keys, uint32_t count,
+		      struct tuple **result) const
+{
+	/*
+	 * A lookup is a chain of dependent cache misses: the hash
+	 * table record, then the tuple to compare the key with.
+	 * Take the misses of a batch of keys together: hash all
+	 * keys and prefetch their records, then prefetch the
+	 * tuples, and only then do the lookups.
+	 */
+	const char *key[HASH_PROBE_BATCH];
+	uint32_t hash[HASH_PROBE_BATCH];
+	for (uint32_t i = 0; i < count; i += HASH_PROBE_BATCH) {
+		uint32_t n = MIN((uint32_t) HASH_PROBE_BATCH, count - i);
+		for (uint32_t j = 0; j < n; j++) {
+			uint32_t part_count = mp_decode_array(&keys);
+			assert(part_count == key_def->part_count);
+			key[j] = keys;
+			for (uint32_t part = 0; part < part_count; part++)
+				mp_next(&keys);
+			hash[j] = key_hash(key[j], key_def);
+			light_index_prefetch(hash_table, hash[j], false);
+		}
+		for (uint32_t j = 0; j < n; j++)
+			light_index_prefetch(hash_table, hash[j], true);
+		for (uint32_t j = 0; j < n; j++) {
+			uint32_t k = light_index_find_key(hash_table, hash[j],
+							  key[j]);
+			result[i + j] = k != light_index_end ?
+				light_index_get(hash_table, k) : NULL;
+		}
+	}
+}
+
 struct tuple *
 MemtxHash::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 		   enum dup_replace_mode mode)
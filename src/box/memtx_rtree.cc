@@ -165,10 +165,12 @@ MemtxRTree::~MemtxRTree()
 		m_position = NULL;
 	}
 	rtree_destroy(&tree);
+	free(build_array);
 }
 
 MemtxRTree::MemtxRTree(struct key_def *key_def)
-  : Index(key_def)
+  : Index(key_def), build_array(NULL), build_array_size(0),
+    build_array_alloc_size(0)
 {
 	assert(key_def->part_count == 1);
 	assert(key_def->parts[0].type = ARRAY);
@@ -373,4 +375,50 @@ MemtxRTree::beginBuild()
 	rtree_purge(&tree);
 }
 
+void
+MemtxRTree::reserve(uint32_t size_hint)
+{
+	if (size_hint < build_array_alloc_size)
+		return;
+	struct rtree_bulk_entry *array = (struct rtree_bulk_entry *)
+		realloc(build_array, size_hint * sizeof(*build_array));
+	if (array == NULL) {
+		tnt_raise(ClientError, ER_MEMORY_ISSUE,
+			  size_hint * sizeof(*build_array),
+			  "MemtxRTree", "build array");
+	}
+	build_array = array;
+	build_array_alloc_size = size_hint;
+}
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	if (build_array_size == build_array_alloc_size) {
+		reserve(build_array_alloc_size + build_array_alloc_size / 2 +
+			MEMTX_EXTENT_SIZE / sizeof(*build_array));
+	}
+	struct rtree_bulk_entry *entry = &build_array[build_array_size];
+	extract_rectangle(&entry->rect, tuple, key_def);
+	entry->record = tuple;
+	build_array_size++;
+}
+
+void
+MemtxRTree::sortBuild()
+{
+	rtree_bulk_sort(build_array, build_array_size);
+}
+
+void
+MemtxRTree::endBuild()
+{
+	rtree_bulk_load(&tree, build_array, build_array_size);
+
+	free(build_array);
+	build_array = NULL;
+	build_array_size = 0;
+	build_array_alloc_size = 0;
+}
+
 
@@ -40,6 +40,10 @@ public:
 	~MemtxRTree();
 
 	virtual void beginBuild();
+	virtual void reserve(uint32_t size_hint);
+	virtual void buildNext(struct tuple *tuple);
+	virtual void sortBuild();
+	virtual void endBuild();
 	virtual size_t size() const;
 	virtual struct tuple *findByKey(const char *key, uint32_t part_count) const;
 	virtual struct tuple *replace(struct tuple *old_tuple,
@@ -54,6 +58,9 @@ public:
 
 protected:
 	struct rtree tree;
+	/** Records collected by buildNext() for a bulk load. */
+	struct rtree_bulk_entry *build_array;
+	size_t build_array_size, build_array_alloc_size;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_RTREE_H_INCLUDED */
@@ -36,11 +36,33 @@
 
 /* {{{ Utilities. *************************************************/
 
-struct key_data
+/**
+ * Calculate the prefix of a key, given its first part.
+ * @sa struct tree_elem
+ */
+static inline uint64_t
+tree_index_prefix(const char *field, struct key_def *key_def)
 {
-	const char *key;
-	uint32_t part_count;
-};
+	switch (key_def->parts[0].type) {
+	case NUM:
+		return mp_decode_uint(&field);
+	case STRING:
+	{
+		uint32_t len;
+		const char *str = mp_decode_str(&field, &len);
+		uint64_t prefix = 0;
+		for (uint32_t i = 0; i < sizeof(prefix); i++) {
+			prefix <<= 8;
+			if (i < len)
+				prefix |= (unsigned char) str[i];
+		}
+		return prefix;
+	}
+	default:
+		/* All prefixes are equal, compare the tuples. */
+		return 0;
+	}
+}
 
 int
 tree_index_compare(const tuple *a, const tuple *b, struct key_def *key_def)
@@ -59,8 +81,8 @@ tree_index_compare_key(const tuple *a, const key_data *key_data,
 }
 int tree_index_qcompare(const void* a, const void *b, void *c)
 {
-	return tree_index_compare(*(struct tuple **)a,
-		*(struct tuple **)b, (struct key_def *)c);
+	return tree_elem_compare(*(struct tree_elem *)a,
+		*(struct tree_elem *)b, (struct key_def *)c);
 }
 
 /* {{{ MemtxTree Iterators ****************************************/
@@ -99,49 +121,53 @@ static struct tuple *
 tree_iterator_fwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_elem *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_bwd(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_elem *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_prev(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_elem *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
-	if (tree_index_compare_key(*res, &it->key_data, it->key_def) != 0) {
+	if (tree_elem_compare_key(*res, &it->key_data, it->key_def) != 0) {
 		it->bps_tree_iter = bps_tree_index_invalid_iterator();
 		return 0;
 	}
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
 tree_iterator_fwd_check_next_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_elem *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
 	bps_tree_index_itr_next(it->tree, &it->bps_tree_iter);
 	iterator->next = tree_iterator_fwd_check_equality;
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -157,15 +183,16 @@ static struct tuple *
 tree_iterator_bwd_check_equality(struct iterator *iterator)
 {
 	struct tree_iterator *it = tree_iterator(iterator);
-	tuple **res = bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
+	struct tree_elem *res =
+		bps_tree_index_itr_get_elem(it->tree, &it->bps_tree_iter);
 	if (!res)
 		return 0;
-	if (tree_index_compare_key(*res, &it->key_data, it->key_def) != 0) {
+	if (tree_elem_compare_key(*res, &it->key_data, it->key_def) != 0) {
 		it->bps_tree_iter = bps_tree_index_invalid_iterator();
 		return 0;
 	}
 	bps_tree_index_itr_prev(it->tree, &it->bps_tree_iter);
-	return *res;
+	return res->tuple;
 }
 
 static struct tuple *
@@ -196,6 +223,18 @@ MemtxTree::~MemtxTree()
 	free(build_array);
 }
 
+struct tree_elem
+MemtxTree::elem(struct tuple *tuple) const
+{
+	struct tree_elem elem;
+	elem.tuple = tuple;
+	elem.prefix = tree_index_prefix(tuple_field_old(tuple_format(tuple),
+							tuple,
+							key_def->parts[0].fieldno),
+					key_def);
+	return elem;
+}
+
 size_t
 MemtxTree::size() const
 {
@@ -211,8 +250,8 @@ MemtxTree::memsize() const
 struct tuple *
 MemtxTree::random(uint32_t rnd) const
 {
-	struct tuple **res = bps_tree_index_random(&tree, rnd);
-	return res ? *res : 0;
+	struct tree_elem *res = bps_tree_index_random(&tree, rnd);
+	return res ? res->tuple : 0;
 }
 
 struct tuple *
@@ -223,8 +262,9 @@ MemtxTree::findByKey(const char *key, uint32_t part_count) const
 	struct key_data key_data;
 	key_data.key = key;
 	key_data.part_count = part_count;
-	struct tuple **res = bps_tree_index_find(&tree, &key_data);
-	return res ? *res : 0;
+	key_data.prefix = tree_index_prefix(key, key_def);
+	struct tree_elem *res = bps_tree_index_find(&tree, &key_data);
+	return res ? res->tuple : 0;
 }
 
 struct tuple *
@@ -234,29 +274,32 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	uint32_t errcode;
 
 	if (new_tuple) {
-		struct tuple *dup_tuple = NULL;
+		struct tree_elem new_elem = elem(new_tuple);
+		struct tree_elem dup_elem;
+		dup_elem.tuple = NULL;
 
 		/* Try to optimistically replace the new_tuple. */
 		bool tree_res =
-		bps_tree_index_insert(&tree, new_tuple, &dup_tuple);
+		bps_tree_index_insert(&tree, new_elem, &dup_elem);
 		if (!tree_res) {
 			tnt_raise(ClientError, ER_MEMORY_ISSUE,
 				  BPS_TREE_EXTENT_SIZE, "MemtxTree", "replace");
 		}
+		struct tuple *dup_tuple = dup_elem.tuple;
 
 		errcode = replace_check_dup(old_tuple, dup_tuple, mode);
 
 		if (errcode) {
-			bps_tree_index_delete(&tree, new_tuple);
+			bps_tree_index_delete(&tree, new_elem);
 			if (dup_tuple)
-				bps_tree_index_insert(&tree, dup_tuple, 0);
+				bps_tree_index_insert(&tree, dup_elem, 0);
 			tnt_raise(ClientError, errcode, index_name(this));
 		}
 		if (dup_tuple)
 			return dup_tuple;
 	}
 	if (old_tuple) {
-		bps_tree_index_delete(&tree, old_tuple);
+		bps_tree_index_delete(&tree, elem(old_tuple));
 	}
 	return old_tuple;
 }
@@ -299,6 +342,8 @@ MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 	}
 	it->key_data.key = key;
 	it->key_data.part_count = part_count;
+	if (part_count > 0)
+		it->key_data.prefix = tree_index_prefix(key, key_def);
 
 	bool exact = false;
 	if (key == 0) {
@@ -359,8 +404,8 @@ MemtxTree::reserve(uint32_t size_hint)
 {
 	if (size_hint < build_array_alloc_size)
 		return;
-	build_array = (struct tuple**)
-		realloc(build_array, size_hint * sizeof(struct tuple *));
+	build_array = (struct tree_elem *)
+		realloc(build_array, size_hint * sizeof(struct tree_elem));
 	build_array_alloc_size = size_hint;
 }
 
@@ -368,26 +413,33 @@ void
 MemtxTree::buildNext(struct tuple *tuple)
 {
 	if (!build_array) {
-		build_array = (struct tuple**)malloc(BPS_TREE_EXTENT_SIZE);
+		build_array = (struct tree_elem *)
+			malloc(BPS_TREE_EXTENT_SIZE);
 		build_array_alloc_size =
-			BPS_TREE_EXTENT_SIZE / sizeof(struct tuple*);
+			BPS_TREE_EXTENT_SIZE / sizeof(struct tree_elem);
 	}
 	assert(build_array_size <= build_array_alloc_size);
 	if (build_array_size == build_array_alloc_size) {
 		build_array_alloc_size = build_array_alloc_size +
 					 build_array_alloc_size / 2;
-		build_array = (struct tuple**)
+		build_array = (struct tree_elem *)
 			realloc(build_array,
 				build_array_alloc_size *
-				sizeof(struct tuple *));
+				sizeof(struct tree_elem));
 	}
-	build_array[build_array_size++] = tuple;
+	build_array[build_array_size++] = elem(tuple);
+}
+
+void
+MemtxTree::sortBuild()
+{
+	qsort_arg(build_array, build_array_size, sizeof(struct tree_elem),
+		  tree_index_qcompare, key_def);
 }
 
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), tree_index_qcompare, key_def);
 	bps_tree_index_build(&tree, build_array, build_array_size);
 
 	free(build_array);
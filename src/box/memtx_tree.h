@@ -33,7 +33,43 @@
 #include "memtx_engine.h"
 
 struct tuple;
-struct key_data;
+
+/**
+ * An element of the tree: a tuple and a prefix of its key.
+ *
+ * The prefix is the first key part converted to an integer,
+ * so that prefixes of different keys compare the same way as
+ * the keys themselves, unless they are equal: a NUM part is
+ * taken as is, a STR part gives its first 8 bytes. A search
+ * descends the tree comparing prefixes, which are stored
+ * right in the tree blocks, and only looks into the tuple
+ * when the prefixes are equal.
+ */
+struct tree_elem {
+	struct tuple *tuple;
+	uint64_t prefix;
+};
+
+/** Elements of the tree are compared by identity by bps_tree.h. */
+static inline bool
+operator==(const struct tree_elem &a, const struct tree_elem &b)
+{
+	return a.tuple == b.tuple;
+}
+
+static inline bool
+operator!=(const struct tree_elem &a, const struct tree_elem &b)
+{
+	return a.tuple != b.tuple;
+}
+
+struct key_data
+{
+	const char *key;
+	uint32_t part_count;
+	/** Prefix of the key, valid if part_count > 0. */
+	uint64_t prefix;
+};
 
 int
 tree_index_compare(const struct tuple *a, const struct tuple *b, struct key_def *key_def);
@@ -41,12 +77,31 @@ tree_index_compare(const struct tuple *a, const struct tuple *b, struct key_def
 int
 tree_index_compare_key(const tuple *a, const key_data *b, struct key_def *key_def);
 
+static inline int
+tree_elem_compare(const struct tree_elem &a, const struct tree_elem &b,
+		  struct key_def *key_def)
+{
+	if (a.prefix != b.prefix)
+		return a.prefix < b.prefix ? -1 : 1;
+	return tree_index_compare(a.tuple, b.tuple, key_def);
+}
+
+static inline int
+tree_elem_compare_key(const struct tree_elem &a,
+		      const struct key_data *key_data,
+		      struct key_def *key_def)
+{
+	if (key_data->part_count > 0 && a.prefix != key_data->prefix)
+		return a.prefix < key_data->prefix ? -1 : 1;
+	return tree_index_compare_key(a.tuple, key_data, key_def);
+}
+
 #define BPS_TREE_NAME _index
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
-#define BPS_TREE_COMPARE(a, b, arg) tree_index_compare(a, b, arg)
-#define BPS_TREE_COMPARE_KEY(a, b, arg) tree_index_compare_key(a, b, arg)
-#define bps_tree_elem_t struct tuple *
+#define BPS_TREE_COMPARE(a, b, arg) tree_elem_compare(a, b, arg)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) tree_elem_compare_key(a, b, arg)
+#define bps_tree_elem_t struct tree_elem
 #define bps_tree_key_t struct key_data *
 #define bps_tree_arg_t struct key_def *
 
@@ -60,6 +115,7 @@ public:
 	virtual void beginBuild();
 	virtual void reserve(uint32_t size_hint);
 	virtual void buildNext(struct tuple *tuple);
+	virtual void sortBuild();
 	virtual void endBuild();
 	virtual size_t size() const;
 	virtual struct tuple *random(uint32_t rnd) const;
@@ -75,8 +131,12 @@ public:
 				  const char *key, uint32_t part_count) const;
 
 // protected:
+	/** Make a tree element of a tuple. */
+	struct tree_elem
+	elem(struct tuple *tuple) const;
+
 	struct bps_tree_index tree;
-	struct tuple **build_array;
+	struct tree_elem *build_array;
 	size_t build_array_size, build_array_alloc_size;
 };
 
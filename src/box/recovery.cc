@@ -314,6 +314,308 @@ recover_xlog(struct recovery_state *r, struct xlog *l)
 	return !i.eof_read;
 }
 
+/* {{{ snapshot reader */
+
+enum {
+	/** Max number of rows in a batch of the snapshot reader. */
+	SNAP_BATCH_ROWS = 1024,
+	/** Initial size of a batch buffer for row bodies. */
+	SNAP_BATCH_SIZE = 1024 * 1024,
+	/**
+	 * Max number of batches in use, to limit memory
+	 * consumption if the reader is ahead of the applier.
+	 */
+	SNAP_BATCH_MAX = 8,
+};
+
+/** A batch of rows read from a snapshot. */
+struct snap_batch
+{
+	STAILQ_ENTRY(snap_batch) next;
+	struct xrow_header rows[SNAP_BATCH_ROWS];
+	int row_count;
+	/** Row bodies are copied here. */
+	char *buf;
+	size_t used;
+	size_t capacity;
+};
+
+STAILQ_HEAD(snap_batch_fifo, snap_batch);
+
+/**
+ * Reads rows of a snapshot in a separate thread: the thread
+ * does file I/O, checksum validation and header decoding,
+ * while the caller applies rows of the previous batches.
+ */
+struct snap_reader
+{
+	struct cord cord;
+	struct xlog_cursor *cursor;
+	pthread_mutex_t mutex;
+	/** Signalled when a batch is read or the reader is done. */
+	pthread_cond_t input_cond;
+	/** Signalled when a batch is released or on stop. */
+	pthread_cond_t free_cond;
+	/** Batches read, not applied yet. */
+	struct snap_batch_fifo input;
+	/** Applied batches, for reuse. */
+	struct snap_batch_fifo free;
+	/** Total number of allocated batches. */
+	int batch_count;
+	/** Set by the reader at EOF or on error. */
+	bool is_done;
+	/** Set by the applier to stop reading. */
+	bool is_stopped;
+	/** An error of the reader thread. */
+	Exception *exception;
+};
+
+static void
+snap_reader_create(struct snap_reader *reader, struct xlog_cursor *cursor)
+{
+	reader->cursor = cursor;
+	tt_pthread_mutex_init(&reader->mutex, NULL);
+	tt_pthread_cond_init(&reader->input_cond, NULL);
+	tt_pthread_cond_init(&reader->free_cond, NULL);
+	STAILQ_INIT(&reader->input);
+	STAILQ_INIT(&reader->free);
+	reader->batch_count = 0;
+	reader->is_done = false;
+	reader->is_stopped = false;
+	Exception::init(&reader->exception);
+}
+
+static void
+snap_reader_destroy(struct snap_reader *reader)
+{
+	struct snap_batch *batch, *tmp;
+	STAILQ_CONCAT(&reader->free, &reader->input);
+	STAILQ_FOREACH_SAFE(batch, &reader->free, next, tmp) {
+		free(batch->buf);
+		free(batch);
+	}
+	Exception::cleanup(&reader->exception);
+	tt_pthread_cond_destroy(&reader->free_cond);
+	tt_pthread_cond_destroy(&reader->input_cond);
+	tt_pthread_mutex_destroy(&reader->mutex);
+}
+
+/**
+ * Get an empty batch, waiting for one to be released if
+ * too many are in use. Invoked in the reader thread.
+ * @retval NULL the reader is stopped
+ */
+static struct snap_batch *
+snap_reader_get_batch(struct snap_reader *reader)
+{
+	struct snap_batch *batch = NULL;
+	tt_pthread_mutex_lock(&reader->mutex);
+	while (STAILQ_EMPTY(&reader->free) && ! reader->is_stopped &&
+	       reader->batch_count == SNAP_BATCH_MAX) {
+		tt_pthread_cond_wait(&reader->free_cond, &reader->mutex);
+	}
+	bool is_stopped = reader->is_stopped;
+	if (! is_stopped && ! STAILQ_EMPTY(&reader->free)) {
+		batch = STAILQ_FIRST(&reader->free);
+		STAILQ_REMOVE_HEAD(&reader->free, next);
+	} else if (! is_stopped) {
+		reader->batch_count++;
+	}
+	tt_pthread_mutex_unlock(&reader->mutex);
+	if (is_stopped)
+		return NULL;
+	if (batch == NULL) {
+		batch = (struct snap_batch *) calloc(1, sizeof(*batch));
+		if (batch == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*batch),
+				  "malloc", "struct snap_batch");
+		}
+	}
+	batch->row_count = 0;
+	batch->used = 0;
+	return batch;
+}
+
+/** Pass a batch of rows to the applier. */
+static void
+snap_reader_push(struct snap_reader *reader, struct snap_batch *batch)
+{
+	tt_pthread_mutex_lock(&reader->mutex);
+	STAILQ_INSERT_TAIL(&reader->input, batch, next);
+	tt_pthread_cond_signal(&reader->input_cond);
+	tt_pthread_mutex_unlock(&reader->mutex);
+}
+
+/**
+ * Copy row bodies into the batch buffer: the cursor
+ * reuses its memory for subsequent rows.
+ * @retval -1 the row doesn't fit, and the batch is not empty
+ */
+static int
+snap_batch_add_row(struct snap_batch *batch, struct xrow_header *row)
+{
+	size_t len = 0;
+	for (int i = 0; i < row->bodycnt; i++)
+		len += row->body[i].iov_len;
+	if (batch->used + len > batch->capacity) {
+		if (batch->row_count > 0)
+			return -1;
+		/* Rows point into the buffer, grow only if empty. */
+		size_t capacity = MAX(len, (size_t) SNAP_BATCH_SIZE);
+		char *buf = (char *) realloc(batch->buf, capacity);
+		if (buf == NULL) {
+			tnt_raise(OutOfMemory, capacity,
+				  "malloc", "struct snap_batch");
+		}
+		batch->buf = buf;
+		batch->capacity = capacity;
+	}
+	struct xrow_header *copy = &batch->rows[batch->row_count++];
+	*copy = *row;
+	for (int i = 0; i < row->bodycnt; i++) {
+		char *body = batch->buf + batch->used;
+		memcpy(body, row->body[i].iov_base, row->body[i].iov_len);
+		copy->body[i].iov_base = body;
+		batch->used += row->body[i].iov_len;
+	}
+	return 0;
+}
+
+static void *
+snap_reader_f(void *arg)
+{
+	struct snap_reader *reader = (struct snap_reader *) arg;
+	struct snap_batch *batch = NULL;
+	try {
+		struct xrow_header row;
+		while (xlog_cursor_next(reader->cursor, &row) == 0) {
+			if (batch != NULL &&
+			    batch->row_count < SNAP_BATCH_ROWS &&
+			    snap_batch_add_row(batch, &row) == 0)
+				continue;
+			/* The batch is full, pass it on. */
+			if (batch != NULL)
+				snap_reader_push(reader, batch);
+			batch = snap_reader_get_batch(reader);
+			if (batch == NULL)
+				break;
+			snap_batch_add_row(batch, &row);
+		}
+	} catch (Exception *) {
+		/* Rows read before the error are applied first. */
+		Exception::move(&fiber()->exception, &reader->exception);
+	}
+	tt_pthread_mutex_lock(&reader->mutex);
+	if (batch != NULL && batch->row_count > 0)
+		STAILQ_INSERT_TAIL(&reader->input, batch, next);
+	else if (batch != NULL)
+		STAILQ_INSERT_TAIL(&reader->free, batch, next);
+	reader->is_done = true;
+	tt_pthread_cond_signal(&reader->input_cond);
+	tt_pthread_mutex_unlock(&reader->mutex);
+	return NULL;
+}
+
+/**
+ * Get the next batch of rows to apply.
+ * @retval NULL all rows are read
+ */
+static struct snap_batch *
+snap_reader_next(struct snap_reader *reader)
+{
+	struct snap_batch *batch = NULL;
+	tt_pthread_mutex_lock(&reader->mutex);
+	while (STAILQ_EMPTY(&reader->input) && ! reader->is_done)
+		tt_pthread_cond_wait(&reader->input_cond, &reader->mutex);
+	if (! STAILQ_EMPTY(&reader->input)) {
+		batch = STAILQ_FIRST(&reader->input);
+		STAILQ_REMOVE_HEAD(&reader->input, next);
+	}
+	tt_pthread_mutex_unlock(&reader->mutex);
+	return batch;
+}
+
+/** Return an applied batch to the reader. */
+static void
+snap_reader_release(struct snap_reader *reader, struct snap_batch *batch)
+{
+	tt_pthread_mutex_lock(&reader->mutex);
+	STAILQ_INSERT_HEAD(&reader->free, batch, next);
+	tt_pthread_cond_signal(&reader->free_cond);
+	tt_pthread_mutex_unlock(&reader->mutex);
+}
+
+/** Stop the reader thread and wait for it to finish. */
+static void
+snap_reader_stop(struct snap_reader *reader)
+{
+	tt_pthread_mutex_lock(&reader->mutex);
+	reader->is_stopped = true;
+	tt_pthread_cond_signal(&reader->free_cond);
+	tt_pthread_mutex_unlock(&reader->mutex);
+	cord_join(&reader->cord);
+}
+
+/**
+ * Like recover_xlog(), but reads rows in a separate thread.
+ * Is used for snapshots, which are large and are not
+ * appended to while being read.
+ *
+ * @retval 0 OK, read full xlog.
+ * @retval 1 OK, read some but not all rows, or no EOF marker
+ */
+static int
+recover_snap_xlog(struct recovery_state *r, struct xlog *l)
+{
+	struct xlog_cursor i;
+
+	xlog_cursor_open(&i, l);
+
+	auto guard = make_scoped_guard([&]{
+		xlog_cursor_close(&i);
+	});
+
+	struct snap_reader reader;
+	snap_reader_create(&reader, &i);
+	if (cord_start(&reader.cord, "snap_reader", snap_reader_f,
+		       &reader) != 0) {
+		snap_reader_destroy(&reader);
+		guard.is_active = false;
+		xlog_cursor_close(&i);
+		return recover_xlog(r, l);
+	}
+	auto reader_guard = make_scoped_guard([&]{
+		snap_reader_stop(&reader);
+		snap_reader_destroy(&reader);
+	});
+
+	struct snap_batch *batch;
+	while ((batch = snap_reader_next(&reader)) != NULL) {
+		for (int k = 0; k < batch->row_count; k++) {
+			try {
+				recovery_apply_row(r, &batch->rows[k]);
+			} catch (ClientError *e) {
+				if (l->dir->panic_if_error)
+					throw;
+				say_error("can't apply row: ");
+				e->log();
+			}
+		}
+		snap_reader_release(&reader, batch);
+	}
+	if (reader.exception != NULL) {
+		Exception::move(&reader.exception, &fiber()->exception);
+		fiber()->exception->raise();
+	}
+	/* See recover_xlog(). */
+	if (l->is_inprogress == false && i.eof_read == false)
+		panic("snapshot `%s' has no EOF marker", l->filename);
+
+	return !i.eof_read;
+}
+
+/* }}} */
+
 void
 recovery_bootstrap(struct recovery_state *r)
 {
@@ -372,7 +674,7 @@ recover_snap(struct recovery_state *r)
 	vclock_add_server(&r->vclock, 0);
 
 	say_info("recovering from `%s'", snap->filename);
-	recover_xlog(r, snap);
+	recover_snap_xlog(r, snap);
 	/* Replace server vclock using the data from snapshot */
 	vclock_copy(&r->vclock, &snap->vclock);
 }
@@ -567,6 +869,270 @@ recovery_finalize(struct recovery_state *r, enum wal_mode wal_mode,
 }
 
 
+/* }}} */
+
+/* {{{ WAL tail: the most recent rows for replication relays */
+
+enum {
+	/** Max number of rows in the WAL tail. */
+	WAL_TAIL_ROWS = 65536,
+	/** Max total size of rows in the WAL tail. */
+	WAL_TAIL_SIZE = 16 * 1024 * 1024,
+	/** How many bytes of rows a relay takes at once. */
+	WAL_TAIL_BATCH = 256 * 1024,
+};
+
+struct wal_tail_row {
+	uint32_t server_id;
+	uint32_t size;
+	int64_t lsn;
+	/** Encoded header and body, malloc()ed. */
+	char *data;
+};
+
+/**
+ * Rows recently written to the WAL. Replication relays take
+ * rows from here instead of reading them back from disk, and
+ * fall back to reading the WAL files only if they lag behind
+ * the tail. The tail is filled by the WAL writer thread while
+ * there are subscribed relays, and always holds a contiguous
+ * range of WAL rows. Rows before the range are summed up in the
+ * vclock of the tail: a relay can start at the tail only if it
+ * has seen all of them.
+ */
+struct wal_tail {
+	pthread_mutex_t mutex;
+	/** Row n of [begin, end) is in rows[n % WAL_TAIL_ROWS]. */
+	struct wal_tail_row *rows;
+	int64_t begin;
+	int64_t end;
+	/** Total size of the rows. */
+	size_t size;
+	/** Subscribed relays, struct wal_tail_watcher. */
+	struct rlist watchers;
+	/** True if the WAL writer runs in this process. */
+	bool is_active;
+	/** WAL writer vclock as of the row at begin. */
+	struct vclock vclock;
+};
+
+static struct wal_tail wal_tail = {
+	PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0,
+	RLIST_INITIALIZER(wal_tail.watchers), false, {}
+};
+
+/** A relay waiting for new rows in the WAL tail. */
+struct wal_tail_watcher {
+	struct rlist link;
+	/** Sent by the WAL writer when rows are added. */
+	ev_async async;
+	struct ev_loop *loop;
+	struct fiber *fiber;
+	/** True while the fiber waits for new rows. */
+	bool is_waiting;
+	/** Set when rows are added, not to miss a wakeup. */
+	bool has_rows;
+};
+
+/** Drop the oldest row. @pre the mutex is locked. */
+static void
+wal_tail_pop(struct wal_tail *tail)
+{
+	assert(tail->begin < tail->end);
+	struct wal_tail_row *row = &tail->rows[tail->begin++ % WAL_TAIL_ROWS];
+	vclock_follow(&tail->vclock, row->server_id, row->lsn);
+	tail->size -= row->size;
+	free(row->data);
+	row->data = NULL;
+}
+
+/**
+ * Forget all rows and skip one position, so that relays
+ * notice the gap. @pre the mutex is locked.
+ */
+static void
+wal_tail_reset(struct wal_tail *tail)
+{
+	while (tail->begin < tail->end)
+		wal_tail_pop(tail);
+	tail->begin = tail->end = tail->end + 1;
+}
+
+/**
+ * Add a row written to the WAL. Runs in the WAL writer thread.
+ * @param vclock the WAL writer vclock before the row
+ * @pre the mutex is locked.
+ */
+static void
+wal_tail_add(struct wal_tail *tail, struct xrow_header *row,
+	     const struct vclock *vclock)
+{
+	if (rlist_empty(&tail->watchers)) {
+		/* Nobody is reading: don't waste memory. */
+		if (tail->begin != tail->end)
+			wal_tail_reset(tail);
+		return;
+	}
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_header_encode(row, iov);
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+	char *data = (char *) malloc(size);
+	if (tail->rows == NULL || data == NULL) {
+		free(data);
+		wal_tail_reset(tail);
+		return;
+	}
+	char *pos = data;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	while (tail->end - tail->begin == WAL_TAIL_ROWS ||
+	       (tail->begin < tail->end && tail->size + size > WAL_TAIL_SIZE))
+		wal_tail_pop(tail);
+	if (tail->begin == tail->end)
+		vclock_copy(&tail->vclock, vclock);
+	struct wal_tail_row *tail_row = &tail->rows[tail->end++ % WAL_TAIL_ROWS];
+	tail_row->server_id = row->server_id;
+	tail_row->lsn = row->lsn;
+	tail_row->size = size;
+	tail_row->data = data;
+	tail->size += size;
+}
+
+/** Wake up the relays. @pre the mutex is locked. */
+static void
+wal_tail_notify(struct wal_tail *tail)
+{
+	struct wal_tail_watcher *watcher;
+	rlist_foreach_entry(watcher, &tail->watchers, link)
+		ev_async_send(watcher->loop, &watcher->async);
+}
+
+static void
+wal_tail_on_write(ev_loop * /* loop */, ev_async *async, int /* events */)
+{
+	struct wal_tail_watcher *watcher =
+		(struct wal_tail_watcher *) async->data;
+	watcher->has_rows = true;
+	/* Don't disturb the fiber if it is sending rows. */
+	if (watcher->is_waiting)
+		fiber_wakeup(watcher->fiber);
+}
+
+static void
+wal_tail_subscribe(struct wal_tail *tail, struct wal_tail_watcher *watcher)
+{
+	watcher->loop = loop();
+	watcher->fiber = fiber();
+	watcher->is_waiting = false;
+	watcher->has_rows = false;
+	ev_async_init(&watcher->async, wal_tail_on_write);
+	watcher->async.data = watcher;
+	ev_async_start(watcher->loop, &watcher->async);
+	tt_pthread_mutex_lock(&tail->mutex);
+	rlist_add_tail_entry(&tail->watchers, watcher, link);
+	tt_pthread_mutex_unlock(&tail->mutex);
+}
+
+static void
+wal_tail_unsubscribe(struct wal_tail *tail, struct wal_tail_watcher *watcher)
+{
+	tt_pthread_mutex_lock(&tail->mutex);
+	rlist_del_entry(watcher, link);
+	tt_pthread_mutex_unlock(&tail->mutex);
+	ev_async_stop(watcher->loop, &watcher->async);
+}
+
+/** True if the relay has already seen the row. */
+static inline bool
+wal_tail_row_is_seen(struct wal_tail_row *row, struct recovery_state *r)
+{
+	return row->lsn <= vclock_get(&r->vclock, row->server_id);
+}
+
+/**
+ * True if the relay has seen all rows before the tail. With
+ * rows of several servers in the WAL, the relay may have seen
+ * the oldest row of the tail but not the older rows of another
+ * server, so every component of the vclock is checked.
+ */
+static inline bool
+wal_tail_is_reachable(struct wal_tail *tail, struct recovery_state *r)
+{
+	int order = vclock_compare(&r->vclock, &tail->vclock);
+	return order != VCLOCK_ORDER_UNDEFINED && order >= 0;
+}
+
+/**
+ * Feed the relay with the rows of the tail it hasn't seen yet,
+ * starting at position *pos.
+ *
+ * @retval >= 0 the number of rows fed
+ * @retval -1 the tail has no rows which immediately follow the
+ *            ones the relay has seen, the relay must read
+ *            the WAL files
+ */
+static int
+wal_tail_read(struct wal_tail *tail, struct recovery_state *r,
+	      int64_t *pos)
+{
+	struct region *gc = &fiber()->gc;
+	tt_pthread_mutex_lock(&tail->mutex);
+	if (*pos < tail->begin || *pos > tail->end) {
+		/*
+		 * Find the position: rows before the oldest
+		 * one are not in the tail, so the relay must
+		 * have seen all of them. Rows of the tail it
+		 * has seen are skipped by recovery_apply_row().
+		 */
+		*pos = tail->begin;
+		if (*pos == tail->end || ! wal_tail_is_reachable(tail, r)) {
+			*pos = -1;
+			tt_pthread_mutex_unlock(&tail->mutex);
+			return -1;
+		}
+		while (*pos < tail->end &&
+		       wal_tail_row_is_seen(&tail->rows[*pos % WAL_TAIL_ROWS], r))
+			++*pos;
+	}
+	/* Copy the rows, the WAL writer may drop them any time. */
+	size_t size = 0;
+	int64_t end = *pos;
+	while (end < tail->end && size < WAL_TAIL_BATCH)
+		size += tail->rows[end++ % WAL_TAIL_ROWS].size;
+	int count = end - *pos;
+	uint32_t *sizes = (uint32_t *)
+		region_alloc_nothrow(gc, count * sizeof(*sizes));
+	char *data = (char *) region_alloc_nothrow(gc, size);
+	if ((sizes == NULL && count > 0) || (data == NULL && size > 0)) {
+		tt_pthread_mutex_unlock(&tail->mutex);
+		tnt_raise(OutOfMemory, size, "region", "WAL tail rows");
+	}
+	char *data_end = data;
+	for (int64_t i = *pos; i < end; i++) {
+		struct wal_tail_row *row = &tail->rows[i % WAL_TAIL_ROWS];
+		memcpy(data_end, row->data, row->size);
+		data_end += row->size;
+		sizes[i - *pos] = row->size;
+	}
+	tt_pthread_mutex_unlock(&tail->mutex);
+
+	const char *row_data = data;
+	for (int i = 0; i < count; i++) {
+		struct xrow_header row;
+		const char *row_end = row_data + sizes[i];
+		xrow_header_decode(&row, &row_data, row_end);
+		row_data = row_end;
+		recovery_apply_row(r, &row);
+		++*pos;
+	}
+	fiber_gc();
+	return count;
+}
+
 /* }}} */
 
 /* {{{ Local recovery: support of hot standby and replication relay */
@@ -578,14 +1144,50 @@ recovery_follow_f(va_list ap)
 	ev_tstamp wal_dir_rescan_delay = va_arg(ap, ev_tstamp);
 	fiber_set_user(fiber(), &admin_credentials);
 
+	/*
+	 * A replication relay takes fresh rows from the WAL
+	 * tail and is woken up by the WAL writer. The files
+	 * are read only to catch up.
+	 */
+	struct wal_tail_watcher watcher;
+	bool use_tail = wal_tail.is_active;
+	int64_t tail_pos = -1;
+	if (use_tail)
+		wal_tail_subscribe(&wal_tail, &watcher);
+	auto guard = make_scoped_guard([&]{
+		if (use_tail)
+			wal_tail_unsubscribe(&wal_tail, &watcher);
+	});
+
 	while (! fiber_is_cancelled()) {
-		recover_remaining_wals(r);
+		watcher.has_rows = false;
+		int count = use_tail ?
+			wal_tail_read(&wal_tail, r, &tail_pos) : -1;
+		if (count < 0) {
+			/*
+			 * The open file, if any, is behind the
+			 * rows taken from the tail, which
+			 * recovery_apply_row() skips.
+			 */
+			recover_remaining_wals(r);
+		} else if (count > 0) {
+			/* There may be more rows in the tail. */
+			continue;
+		}
+		if (r->apply_flush != NULL)
+			r->apply_flush(r, r->apply_row_param);
 		/**
 		 * Allow an immediate wakeup/break loop
 		 * from recovery_stop_local().
 		 */
 		fiber_set_cancellable(true);
-		if (r->current_wal != NULL) {
+		if (use_tail) {
+			if (! watcher.has_rows) {
+				watcher.is_waiting = true;
+				fiber_yield_timeout(wal_dir_rescan_delay);
+				watcher.is_waiting = false;
+			}
+		} else if (r->current_wal != NULL) {
 			ev_stat stat;
 			coio_stat_init(&stat, r->current_wal->filename);
 			coio_stat_stat_timeout(&stat, wal_dir_rescan_delay);
@@ -629,7 +1231,11 @@ struct wal_write_request {
 	/* Auxiliary. */
 	int64_t res;
 	struct fiber *fiber;
-	struct xrow_header *row;
+	/** Rows of a single transaction, written as a whole. */
+	struct xrow_header **rows;
+	int row_count;
+	/** The number of rows already written to disk. */
+	int rows_written;
 };
 
 /* Context of the WAL writer thread. */
@@ -811,6 +1417,10 @@ wal_writer_start(struct recovery_state *r, int rows_per_wal)
 	/* I. Initialize the state. */
 	wal_writer_init(&wal_writer, &r->vclock, rows_per_wal);
 	r->writer = &wal_writer;
+	if (wal_tail.rows == NULL) {
+		wal_tail.rows = (struct wal_tail_row *)
+			calloc(WAL_TAIL_ROWS, sizeof(*wal_tail.rows));
+	}
 
 	ev_async_start(wal_writer.txn_loop, &wal_writer.write_event);
 
@@ -822,6 +1432,7 @@ wal_writer_start(struct recovery_state *r, int rows_per_wal)
 		return -1;
 	}
 	wal_writer.is_started = true;
+	wal_tail.is_active = true;
 	return 0;
 }
 
@@ -844,6 +1455,7 @@ wal_writer_stop(struct recovery_state *r)
 
 	ev_async_stop(writer->txn_loop, &writer->write_event);
 	wal_writer.is_started = false;
+	wal_tail.is_active = false;
 	wal_writer_destroy(writer);
 
 	r->writer = NULL;
@@ -937,7 +1549,7 @@ wal_opt_rotate(struct xlog **wal, struct recovery_state *r,
 	return l ? 0 : -1;
 }
 
-static struct wal_write_request *
+static void
 wal_fill_batch(struct xlog *wal, struct fio_batch *batch, int rows_per_wal,
 	       struct wal_write_request *req)
 {
@@ -947,27 +1559,48 @@ wal_fill_batch(struct xlog *wal, struct fio_batch *batch, int rows_per_wal,
 	fio_batch_start(batch, max_rows);
 
 	struct iovec iov[XROW_IOVMAX];
+	/* The first request may be partially written already. */
+	int row = req->rows_written;
 	while (req != NULL && !fio_batch_has_space(batch, nelem(iov))) {
-		int iovcnt = xlog_encode_row(req->row, iov);
+		int iovcnt = xlog_encode_row(req->rows[row], iov);
 		fio_batch_add(batch, iov, iovcnt);
-		req = STAILQ_NEXT(req, wal_fifo_entry);
+		if (++row == req->row_count) {
+			req = STAILQ_NEXT(req, wal_fifo_entry);
+			row = 0;
+		}
 	}
-	return req;
 }
 
-static struct wal_write_request *
+/**
+ * Write the batch to disk and account the written rows in
+ * the requests they belong to. A request is complete only
+ * when all of its rows are written.
+ *
+ * @return 0 if the whole batch was written, -1 otherwise.
+ * @post *req points at the first incomplete request or is
+ * NULL.
+ */
+static int
 wal_write_batch(struct xlog *wal, struct fio_batch *batch,
-		struct wal_write_request *req, struct wal_write_request *end,
-		struct vclock *vclock)
+		struct wal_write_request **req, struct vclock *vclock)
 {
 	int rows_written = fio_batch_write(batch, fileno(wal->f));
 	wal->rows += rows_written;
-	while (req != end && rows_written-- != 0)  {
-		vclock_follow(vclock, req->row->server_id, req->row->lsn);
-		req->res = 0;
-		req = STAILQ_NEXT(req, wal_fifo_entry);
+	int rc = rows_written == batch->rows ? 0 : -1;
+	tt_pthread_mutex_lock(&wal_tail.mutex);
+	while (rows_written-- != 0)  {
+		struct wal_write_request *r = *req;
+		struct xrow_header *row = r->rows[r->rows_written++];
+		wal_tail_add(&wal_tail, row, vclock);
+		vclock_follow(vclock, row->server_id, row->lsn);
+		if (r->rows_written == r->row_count) {
+			r->res = 0;
+			*req = STAILQ_NEXT(r, wal_fifo_entry);
+		}
 	}
-	return req;
+	wal_tail_notify(&wal_tail);
+	tt_pthread_mutex_unlock(&wal_tail.mutex);
+	return rc;
 }
 
 static void
@@ -979,22 +1612,16 @@ wal_write_to_disk(struct recovery_state *r, struct wal_writer *writer,
 	struct fio_batch *batch = writer->batch;
 
 	struct wal_write_request *req = STAILQ_FIRST(input);
-	struct wal_write_request *write_end = req;
 
 	while (req) {
 		if (wal_opt_rotate(wal, r, &writer->vclock) != 0)
 			break;
-		struct wal_write_request *batch_end;
-		batch_end = wal_fill_batch(*wal, batch, writer->rows_per_wal,
-					   req);
-		write_end = wal_write_batch(*wal, batch, req, batch_end,
-					    &writer->vclock);
-		if (batch_end != write_end)
+		wal_fill_batch(*wal, batch, writer->rows_per_wal, req);
+		if (wal_write_batch(*wal, batch, &req, &writer->vclock) != 0)
 			break;
-		req = write_end;
 	}
 	fiber_gc();
-	STAILQ_SPLICE(input, write_end, wal_fifo_entry, rollback);
+	STAILQ_SPLICE(input, req, wal_fifo_entry, rollback);
 	STAILQ_CONCAT(commit, input);
 }
 
@@ -1037,17 +1664,22 @@ wal_writer_thread(void *worker_args)
 }
 
 /**
- * WAL writer main entry point: queue a single request
- * to be written to disk and wait until this task is completed.
+ * WAL writer main entry point: queue all rows of a transaction
+ * as a single request and wait until it is written to disk.
+ * The writer thread is signalled and the fiber is woken up
+ * once per call, regardless of the number of rows.
  */
 int64_t
-wal_write(struct recovery_state *r, struct xrow_header *row)
+wal_writev(struct recovery_state *r, struct xrow_header **rows,
+	   int row_count)
 {
+	assert(row_count > 0);
 	/*
 	 * Bump current LSN even if wal_mode = NONE, so that
 	 * snapshots still works with WAL turned off.
 	 */
-	fill_lsn(r, row);
+	for (int i = 0; i < row_count; i++)
+		fill_lsn(r, rows[i]);
 	if (r->wal_mode == WAL_NONE)
 		return 0;
 
@@ -1060,9 +1692,14 @@ wal_write(struct recovery_state *r, struct xrow_header *row)
 
 	req->fiber = fiber();
 	req->res = -1;
-	req->row = row;
-	row->tm = ev_now(loop());
-	row->sync = 0;
+	req->rows = rows;
+	req->row_count = row_count;
+	req->rows_written = 0;
+	ev_tstamp now = ev_now(loop());
+	for (int i = 0; i < row_count; i++) {
+		rows[i]->tm = now;
+		rows[i]->sync = 0;
+	}
 
 	(void) tt_pthread_mutex_lock(&writer->mutex);
 
@@ -1086,6 +1723,12 @@ wal_write(struct recovery_state *r, struct xrow_header *row)
 	return req->res;
 }
 
+int64_t
+wal_write(struct recovery_state *r, struct xrow_header *row)
+{
+	return wal_writev(r, &row, 1);
+}
+
 /* }}} */
 
 /* {{{ box.snapshot() */
@@ -37,6 +37,7 @@
 #include "vclock.h"
 #include "tt_uuid.h"
 #include "uri.h"
+#include "fiber.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -48,6 +49,7 @@ struct recovery_state;
 
 typedef void (apply_row_f)(struct recovery_state *, void *,
 			   struct xrow_header *packet);
+typedef void (apply_flush_f)(struct recovery_state *, void *);
 
 /** A "condition variable" that allows fibers to wait when a given
  * LSN makes it to disk.
@@ -63,9 +65,25 @@ extern const char *wal_mode_STRS[];
 
 enum { REMOTE_SOURCE_MAXLEN = 1024 }; /* enough to fit URI with passwords */
 
+/**
+ * Rows read from the master and being applied, each in a
+ * fiber of its own, see remote_apply_row().
+ */
+struct remote_apply {
+	/** The fiber waiting for the rows in flight. */
+	struct fiber *reader;
+	/** The number of rows being applied. */
+	int in_flight;
+	/** True if the reader waits for in_flight to drop. */
+	bool is_waiting;
+	/** The first error to apply a row, if any. */
+	class Exception *error;
+};
+
 /** State of a replication connection to the master */
 struct remote {
 	struct fiber *reader;
+	struct remote_apply apply;
 	const char *status;
 	ev_tstamp lag, last_row_time;
 	bool warning_said;
@@ -99,6 +117,13 @@ struct recovery_state {
 	 * recovery and when reading rows from the master.
 	 */
 	apply_row_f *apply_row;
+	/**
+	 * If set, invoked by local recovery when all rows
+	 * available so far are applied, before it waits for
+	 * more. Lets a replication relay send the rows it
+	 * has buffered.
+	 */
+	apply_flush_f *apply_flush;
 	void *apply_row_param;
 	uint64_t snap_io_rate_limit;
 	enum wal_mode wal_mode;
@@ -142,6 +167,15 @@ void recovery_finalize(struct recovery_state *r, enum wal_mode mode,
 
 int64_t wal_write(struct recovery_state *r, struct xrow_header *packet);
 
+/**
+ * Write rows of a single transaction to the WAL as one batch.
+ * @retval 0 all rows are written
+ * @retval -1 error, no or not all rows are written
+ */
+int64_t
+wal_writev(struct recovery_state *r, struct xrow_header **rows,
+	   int row_count);
+
 void recovery_setup_panic(struct recovery_state *r, bool on_snap_error, bool on_wal_error);
 void recovery_apply_row(struct recovery_state *r, struct xrow_header *packet);
 
@@ -42,6 +42,20 @@
 
 static const int RECONNECT_DELAY = 1.0;
 
+enum {
+	/**
+	 * The master sends rows in batches. Read as much of
+	 * a batch as fits into this many bytes with a single
+	 * system call and decode the rest of it from memory.
+	 */
+	REMOTE_READAHEAD = 128 * 1024,
+	/**
+	 * The maximal number of rows read from the master and
+	 * not yet written to the WAL.
+	 */
+	REMOTE_APPLY_MAX = 256
+};
+
 static void
 remote_read_row(struct ev_io *coio, struct iobuf *iobuf,
 		struct xrow_header *row)
@@ -49,8 +63,10 @@ remote_read_row(struct ev_io *coio, struct iobuf *iobuf,
 	struct ibuf *in = &iobuf->in;
 
 	/* Read fixed header */
-	if (ibuf_size(in) < 1)
+	if (ibuf_size(in) < 1) {
+		ibuf_reserve(in, REMOTE_READAHEAD);
 		coio_breadn(coio, in, 1);
+	}
 
 	/* Read length */
 	if (mp_typeof(*in->pos) != MP_UINT) {
@@ -65,8 +81,10 @@ remote_read_row(struct ev_io *coio, struct iobuf *iobuf,
 
 	/* Read header and body */
 	to_read = len - ibuf_size(in);
-	if (to_read > 0)
+	if (to_read > 0) {
+		ibuf_reserve(in, MAX(to_read, REMOTE_READAHEAD));
 		coio_breadn(coio, in, to_read);
+	}
 
 	xrow_header_decode(row, (const char **) &in->pos, in->pos + len);
 }
@@ -79,6 +97,103 @@ remote_write_row(struct ev_io *coio, const struct xrow_header *row)
 	coio_writev(coio, iov, iovcnt, 0);
 }
 
+/* {{{ Pipelined apply of rows read from the master */
+
+/**
+ * Each row is applied in a fiber of its own, so the reader
+ * doesn't wait for the WAL and keeps reading, while the
+ * WAL writer commits all rows in flight in one batch.
+ *
+ * The WAL requires rows of each server to be written in
+ * LSN order, therefore the rows enter the WAL in the order
+ * they are received. This holds naturally as long as a row
+ * doesn't yield before it's submitted to the WAL, and
+ * implies that all changes of a key are applied in order.
+ * A row that yields earlier, e.g. in a trigger, is waited
+ * for along with all rows before it.
+ */
+static void
+remote_apply_f(va_list ap)
+{
+	struct remote_apply *apply = va_arg(ap, struct remote_apply *);
+	struct recovery_state *r = va_arg(ap, struct recovery_state *);
+	struct xrow_header row = *va_arg(ap, struct xrow_header *);
+	try {
+		/* The reader reuses its input buffer for next rows. */
+		for (int i = 0; i < row.bodycnt; i++) {
+			void *body = region_alloc(&fiber()->gc,
+						  row.body[i].iov_len);
+			memcpy(body, row.body[i].iov_base,
+			       row.body[i].iov_len);
+			row.body[i].iov_base = body;
+		}
+		recovery_apply_row(r, &row);
+	} catch (Exception *e) {
+		if (apply->error == NULL)
+			Exception::move(&fiber()->exception, &apply->error);
+		else
+			e->log();
+	}
+	apply->in_flight--;
+	if (apply->is_waiting)
+		fiber_wakeup(apply->reader);
+}
+
+/** Raise the error of a failed row, if any. */
+static void
+remote_apply_check(struct remote_apply *apply)
+{
+	if (apply->error != NULL) {
+		Exception::move(&apply->error, &fiber()->exception);
+		fiber()->exception->raise();
+	}
+}
+
+/**
+ * Wait until at most max rows are in flight. Not a
+ * cancellation point: the rows keep being applied anyway,
+ * and leaving them behind would pass their count and error
+ * on to the next reader.
+ */
+static void
+remote_apply_wait(struct remote_apply *apply, int max)
+{
+	apply->reader = fiber();
+	while (apply->in_flight > max) {
+		apply->is_waiting = true;
+		fiber_yield();
+		apply->is_waiting = false;
+	}
+}
+
+/**
+ * Start applying a row read from the master. Returns as
+ * soon as the row is submitted to the WAL.
+ */
+static void
+remote_apply_row(struct recovery_state *r, struct xrow_header *row)
+{
+	struct remote_apply *apply = &r->remote.apply;
+	remote_apply_wait(apply, REMOTE_APPLY_MAX - 1);
+	remote_apply_check(apply);
+	struct fiber *f = fiber_new(fiber_name(fiber()), remote_apply_f);
+	apply->in_flight++;
+	int in_flight = apply->in_flight;
+	/* Runs until the row is applied or the fiber yields. */
+	fiber_start(f, apply, r, row);
+	if (apply->in_flight == in_flight &&
+	    vclock_get(&r->vclock, row->server_id) < row->lsn) {
+		/*
+		 * The fiber has yielded before the row got
+		 * into the WAL: apply it synchronously.
+		 */
+		remote_apply_wait(apply, 0);
+	}
+	remote_apply_check(apply);
+}
+
+/* }}} */
+
 static void
 remote_connect(struct recovery_state *r, struct ev_io *coio,
 	       struct iobuf *iobuf)
@@ -249,7 +364,7 @@ pull_from_remote(va_list ap)
 
 			if (iproto_type_is_error(row.type))
 				xrow_decode_error(&row);  /* error */
-			recovery_apply_row(r, &row);
+			remote_apply_row(r, &row);
 
 			iobuf_reset(iobuf);
 			fiber_gc();
@@ -327,6 +442,14 @@ recovery_stop_remote(struct recovery_state *r)
 	 */
 	Exception::cleanup(&f->exception);
 	fiber_join(f);
+	/*
+	 * Let the rows in flight reach the WAL, so that none
+	 * of them is left to the next reader, and forget their
+	 * error, if any: there is no reader to stop anymore.
+	 */
+	struct remote_apply *apply = &r->remote.apply;
+	remote_apply_wait(apply, 0);
+	Exception::cleanup(&apply->error);
 	r->remote.status = "off";
 }
 
@@ -43,11 +43,24 @@
 #include "coio.h"
 #include "cfg.h"
 #include "trigger.h"
+#include "iobuf.h"
 
 static void
 replication_send_row(struct recovery_state *r, void *param,
 		     struct xrow_header *packet);
 
+static void
+replication_flush(struct recovery_state *r, void *param);
+
+enum {
+	/**
+	 * Rows are sent to the replica in batches: the output
+	 * buffer is flushed when it grows beyond this size or
+	 * when there are no more rows to send right now.
+	 */
+	RELAY_FLUSH_SIZE = 128 * 1024
+};
+
 /** State of a replication relay. */
 class Relay {
 public:
@@ -56,11 +69,16 @@ public:
 	/* Request sync */
 	uint64_t sync;
 	struct recovery_state *r;
+	/** Memory of the output buffer, owned by the relay cord. */
+	struct region pool;
+	/** Rows not yet written to the socket. */
+	struct obuf buf;
 
 	Relay(int fd_arg, uint64_t sync_arg)
 	{
 		r = recovery_new(cfg_gets("snap_dir"), cfg_gets("wal_dir"),
 				 replication_send_row, this);
+		r->apply_flush = replication_flush;
 		coio_init(&io);
 		io.fd = fd_arg;
 		sync = sync_arg;
@@ -83,6 +101,44 @@ relay_set_cord_name(int fd)
 	cord_set_name(name);
 }
 
+/**
+ * Create the output buffer. Must be called in the relay
+ * cord, since the memory comes from the cord slab cache.
+ */
+static inline void
+relay_create_buf(Relay *relay)
+{
+	region_create(&relay->pool, &cord()->slabc);
+	obuf_create(&relay->buf, &relay->pool, RELAY_FLUSH_SIZE);
+}
+
+/** Write all buffered rows to the replica. */
+static void
+relay_flush(Relay *relay)
+{
+	size_t size = obuf_size(&relay->buf);
+	if (size == 0)
+		return;
+	coio_writev(&relay->io, relay->buf.iov,
+		    obuf_iovcnt(&relay->buf), size);
+	obuf_reset(&relay->buf);
+}
+
+/**
+ * Append a row to the output buffer, flush the buffer
+ * if it is full enough.
+ */
+static void
+relay_send_row(Relay *relay, struct xrow_header *row)
+{
+	struct iovec iov[XROW_IOVMAX];
+	int iovcnt = xrow_to_iovec(row, iov);
+	for (int i = 0; i < iovcnt; i++)
+		obuf_dup(&relay->buf, iov[i].iov_base, iov[i].iov_len);
+	if (obuf_size(&relay->buf) >= RELAY_FLUSH_SIZE)
+		relay_flush(relay);
+}
+
 void
 replication_join_f(va_list ap)
 {
@@ -90,6 +146,10 @@ replication_join_f(va_list ap)
 	struct recovery_state *r = relay->r;
 
 	relay_set_cord_name(relay->io.fd);
+	relay_create_buf(relay);
+	auto buf_guard = make_scoped_guard([=]{
+		region_destroy(&relay->pool);
+	});
 	/* Send snapshot */
 	recover_snap(r);
 
@@ -97,9 +157,8 @@ replication_join_f(va_list ap)
 	struct xrow_header row;
 	xrow_encode_vclock(&row, &r->vclock);
 	row.sync = relay->sync;
-	struct iovec iov[XROW_IOVMAX];
-	int iovcnt = xrow_to_iovec(&row, iov);
-	coio_writev(&relay->io, iov, iovcnt, 0);
+	relay_send_row(relay, &row);
+	relay_flush(relay);
 	say_info("snapshot sent");
 }
 
@@ -125,6 +184,10 @@ replication_subscribe_f(va_list ap)
 	struct recovery_state *r = relay->r;
 
 	relay_set_cord_name(relay->io.fd);
+	relay_create_buf(relay);
+	auto buf_guard = make_scoped_guard([=]{
+		region_destroy(&relay->pool);
+	});
 	recovery_follow_local(r, 0.1);
 	/*
 	 * Init a read event: when replica closes its end
@@ -210,9 +273,7 @@ replication_send_row(struct recovery_state *r, void *param,
 	 */
 	if (packet->server_id == 0 || packet->server_id != r->server_id)  {
 		packet->sync = relay->sync;
-		struct iovec iov[XROW_IOVMAX];
-		int iovcnt = xrow_to_iovec(packet, iov);
-		coio_writev(&relay->io, iov, iovcnt, 0);
+		relay_send_row(relay, packet);
 	}
 	/*
 	 * Update local vclock. During normal operation wal_write()
@@ -221,3 +282,13 @@ replication_send_row(struct recovery_state *r, void *param,
 	 */
 	vclock_follow(&r->vclock, packet->server_id, packet->lsn);
 }
+
+/**
+ * Send the rows accumulated by replication_send_row():
+ * local recovery has nothing more to feed at the moment.
+ */
+static void
+replication_flush(struct recovery_state * /* r */, void *param)
+{
+	relay_flush((Relay *) param);
+}
@@ -43,6 +43,7 @@
 #include "stat.h"
 
 int stat_base;
+struct histogram latency_request[IPROTO_TYPE_STAT_MAX];
 
 enum dup_replace_mode
 dup_replace_mode(uint32_t op)
@@ -144,8 +145,18 @@ execute_select(struct request *request, struct port *port)
 	const char *key = request->key;
 	uint32_t part_count = key ? mp_decode_array(&key) : 0;
 
-	struct iterator *it = index->position();
 	key_validate(index->key_def, type, key, part_count);
+	/*
+	 * The pre-allocated iterator is shared by all fibers:
+	 * an engine which yields on read needs a private one.
+	 */
+	bool no_yield = engine_no_yield(space->handler->engine->flags);
+	struct iterator *it = no_yield ? index->position() :
+		index->allocIterator();
+	auto free_guard = make_scoped_guard([=] {
+		if (! no_yield)
+			it->free(it);
+	});
 	index->initIterator(it, type, key, part_count);
 	auto iterator_guard =
 		make_scoped_guard([=] { iterator_close(it); });
@@ -190,6 +201,7 @@ process_rw(struct request *request, struct port *port)
 	request_execute_f fun = execute_map[request->type];
 	assert(fun != NULL);
 	stat_collect(stat_base, request->type, 1);
+	int64_t start = clock_monotonic64();
 	try {
 		fun(request, port);
 		port_eof(port);
@@ -197,6 +209,11 @@ process_rw(struct request *request, struct port *port)
 		txn_rollback_stmt();
 		throw;
 	}
+	/* The space may be gone if the request has dropped it. */
+	struct space *space = space_by_id(request->space_id);
+	if (space != NULL)
+		histogram_collect(&space->latency,
+				  clock_monotonic64() - start);
 }
 
 void
@@ -30,10 +30,14 @@
  */
 #include <stdbool.h>
 #include "xrow.h"
+#include "iproto_constants.h"
+#include "histogram.h"
 
 struct txn;
 struct port;
 extern int stat_base;
+/** Request execution time, by request type. */
+extern struct histogram latency_request[IPROTO_TYPE_STAT_MAX];
 
 struct request
 {
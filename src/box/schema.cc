@@ -37,6 +37,7 @@
 #include "key_def.h"
 #include "alter.h"
 #include "scoped_guard.h"
+#include "third_party/PMurHash.h"
 #include <stdio.h>
 /**
  * @module Data Dictionary
@@ -56,6 +57,8 @@
 /** All existing spaces. */
 static struct mh_i32ptr_t *spaces;
 static struct mh_i32ptr_t *funcs;
+/** The same functions, by name: resolves CALL privileges. */
+static struct mh_strnptr_t *funcs_by_name;
 int sc_version;
 
 bool
@@ -222,6 +225,7 @@ schema_init()
 	/* Initialize the space cache. */
 	spaces = mh_i32ptr_new();
 	funcs = mh_i32ptr_new();
+	funcs_by_name = mh_strnptr_new();
 	/*
 	 * Create surrogate space objects for the mandatory system
 	 * spaces (the primal eggs from which we get all the
@@ -316,6 +320,39 @@ schema_free(void)
 		func_cache_delete(func->fid);
 	}
 	mh_i32ptr_delete(funcs);
+	mh_strnptr_delete(funcs_by_name);
+}
+
+static inline void
+func_name_key(struct mh_strnptr_node_t *node, const char *name,
+	      uint32_t name_len)
+{
+	node->str = name;
+	node->len = name_len;
+	node->hash = PMurHash32(13, name, name_len);
+}
+
+static void
+func_cache_put_name(struct func_def *func)
+{
+	struct mh_strnptr_node_t node;
+	func_name_key(&node, func->name, strlen(func->name));
+	node.val = func;
+	mh_int_t k = mh_strnptr_put(funcs_by_name, &node, NULL, NULL);
+	if (k == mh_end(funcs_by_name)) {
+		panic_syserror("Out of memory for the data "
+			       "dictionary cache.");
+	}
+}
+
+static void
+func_cache_del_name(struct func_def *func)
+{
+	struct mh_strnptr_node_t key;
+	func_name_key(&key, func->name, strlen(func->name));
+	mh_int_t k = mh_strnptr_find(funcs_by_name, &key, NULL);
+	if (k != mh_end(funcs_by_name))
+		mh_strnptr_del(funcs_by_name, k, NULL);
 }
 
 void
@@ -323,7 +360,10 @@ func_cache_replace(struct func_def *func)
 {
 	struct func_def *old = func_by_id(func->fid);
 	if (old) {
+		/* The name may change, it is the key. */
+		func_cache_del_name(old);
 		*old = *func;
+		func_cache_put_name(old);
 		return;
 	}
 	if (mh_size(funcs) >= BOX_FUNCTION_MAX)
@@ -340,6 +380,7 @@ error:
 	mh_int_t k = mh_i32ptr_put(funcs, &node, NULL, NULL);
 	if (k == mh_end(funcs))
 		goto error;
+	func_cache_put_name(func);
 }
 
 void
@@ -351,6 +392,7 @@ func_cache_delete(uint32_t fid)
 	struct func_def *func = (struct func_def *)
 		mh_i32ptr_node(funcs, k)->val;
 	mh_i32ptr_del(funcs, k, NULL);
+	func_cache_del_name(func);
 	free(func);
 }
 
@@ -363,6 +405,17 @@ func_by_id(uint32_t fid)
 	return (struct func_def *) mh_i32ptr_node(funcs, func)->val;
 }
 
+struct func_def *
+func_by_name(const char *name, uint32_t name_len)
+{
+	struct mh_strnptr_node_t key;
+	func_name_key(&key, name, name_len);
+	mh_int_t func = mh_strnptr_find(funcs_by_name, &key, NULL);
+	if (func == mh_end(funcs_by_name))
+		return NULL;
+	return (struct func_def *) mh_strnptr_node(funcs_by_name, func)->val;
+}
+
 bool
 schema_find_grants(const char *type, uint32_t id)
 {
@@ -132,12 +132,9 @@ func_cache_find(uint32_t fid)
 	return func;
 }
 
-static inline struct func_def *
-func_by_name(const char *name, uint32_t name_len)
-{
-	uint32_t fid = schema_find_id(SC_FUNC_ID, 2, name, name_len);
-	return func_by_id(fid);
-}
+/** Find a function by name in the function cache. */
+struct func_def *
+func_by_name(const char *name, uint32_t name_len);
 
 /**
  * Check whether or not an object has grants on it (restrict
@@ -35,7 +35,9 @@
 #include "index.h"
 #include "sophia_index.h"
 #include "space.h"
+#include "schema.h"
 #include "salad/rlist.h"
+#include "coeio.h"
 #include <sophia.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -55,6 +57,81 @@ void sophia_raise(void *env)
 	tnt_raise(ClientError, ER_SOPHIA, error);
 }
 
+/* {{{ Reads in the coeio thread pool */
+
+/** A read running in a coeio worker. */
+struct sophia_read_task {
+	/** The fiber waiting for the read. */
+	struct fiber *fiber;
+	/** A database, a transaction or a cursor. */
+	void *src;
+	/** The key to look up, NULL to advance a cursor. */
+	void *key;
+	void *result;
+	/** Set in TX once the worker is done with the task. */
+	bool complete;
+};
+
+static void
+sophia_read_cb(eio_req *req)
+{
+	struct sophia_read_task *task = (struct sophia_read_task *) req->data;
+	task->result = task->key ?
+		sp_get(task->src, task->key) : sp_get(task->src);
+}
+
+static int
+sophia_read_on_complete(eio_req *req)
+{
+	struct sophia_read_task *task = (struct sophia_read_task *) req->data;
+	task->complete = true;
+	fiber_wakeup(task->fiber);
+	return 0;
+}
+
+void *
+sophia_read(const SophiaIndex *index, void *src, void *key)
+{
+	if (index->is_dropped) {
+		/* Don't let new reads delay the drop. */
+		if (key != NULL)
+			sp_destroy(key);
+		struct space *space =
+			space_cache_find(index->key_def->space_id);
+		tnt_raise(ClientError, ER_NO_SUCH_INDEX, index_id(index),
+			  space_name(space));
+	}
+	struct sophia_read_task task;
+	task.fiber = fiber();
+	task.src = src;
+	task.key = key;
+	task.result = NULL;
+	task.complete = false;
+	index->reads_in_progress++;
+	struct eio_req *req = eio_custom(sophia_read_cb, 0,
+					 sophia_read_on_complete, &task);
+	if (req == NULL) {
+		/* Failed to create a task, read in place. */
+		task.result = key ? sp_get(src, key) : sp_get(src);
+	} else {
+		/*
+		 * The worker uses the task, the key and the
+		 * cursor until it's done: a spurious wakeup,
+		 * e.g. fiber:wakeup() from Lua, must not let
+		 * the caller destroy them.
+		 */
+		bool cancellable = fiber_set_cancellable(false);
+		while (! task.complete)
+			fiber_yield();
+		fiber_set_cancellable(cancellable);
+	}
+	if (--index->reads_in_progress == 0 && index->drop_waiter != NULL)
+		fiber_wakeup(index->drop_waiter);
+	return task.result;
+}
+
+/* }}} */
+
 void sophia_info(void (*callback)(const char*, const char*, void*), void *arg)
 {
 	SophiaEngine *engine = (SophiaEngine*)engine_find("sophia");
@@ -111,7 +188,7 @@ SophiaEngine::SophiaEngine()
 	 ,m_prev_checkpoint_lsn(-1)
 	 ,m_checkpoint_lsn(-1)
 {
-	flags = 0;
+	flags = ENGINE_TRANSIENT_TUPLES;
 	env = NULL;
 	recovery.state   = READY_NO_KEYS;
 	recovery.recover = sophia_recovery_begin_snapshot;
@@ -180,6 +257,16 @@ void
 SophiaEngine::dropIndex(Index *index)
 {
 	SophiaIndex *i = (SophiaIndex*)index;
+	/*
+	 * A read in a coeio thread may still use the database.
+	 * Refuse new reads and wait for the running ones: the
+	 * last of them wakes us up.
+	 */
+	i->is_dropped = true;
+	i->drop_waiter = fiber();
+	while (i->reads_in_progress > 0)
+		fiber_yield();
+	i->drop_waiter = NULL;
 	/* schedule asynchronous drop */
 	int rc = sp_drop(i->db);
 	if (rc == -1)
@@ -203,30 +290,14 @@ SophiaEngine::keydefCheck(struct space *space, struct key_def *key_def)
 {
 	switch (key_def->type) {
 	case TREE:
-		if (! key_def->is_unique) {
-			tnt_raise(ClientError, ER_MODIFY_INDEX,
-				  key_def->name,
-				  space_name(space),
-				  "Sophia TREE index must be unique");
-		}
-		if (key_def->iid != 0) {
-			tnt_raise(ClientError, ER_MODIFY_INDEX,
-				  key_def->name,
-				  space_name(space),
-				  "Sophia TREE secondary indexes are not supported");
-		}
-		if (key_def->part_count != 1) {
-			tnt_raise(ClientError, ER_MODIFY_INDEX,
-				  key_def->name,
-				  space_name(space),
-				  "Sophia TREE index key can not be multipart");
-		}
-		if (key_def->parts[0].type != NUM &&
-		    key_def->parts[0].type != STRING) {
-			tnt_raise(ClientError, ER_MODIFY_INDEX,
-				  key_def->name,
-				  space_name(space),
-				  "Sophia TREE index field type must be STR or NUM");
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			enum field_type type = key_def->parts[i].type;
+			if (type != NUM && type != STRING) {
+				tnt_raise(ClientError, ER_MODIFY_INDEX,
+					  key_def->name,
+					  space_name(space),
+					  "Sophia TREE index field type must be STR or NUM");
+			}
 		}
 		break;
 	default:
@@ -56,6 +56,17 @@ private:
 void sophia_info(void (*)(const char*, const char*, void*), void*);
 void sophia_raise(void*);
 
+class SophiaIndex;
+
+/**
+ * sp_get() of a key from a database or a transaction, or of
+ * the next object of a cursor if the key is NULL. The call
+ * may read from disk, so it runs in a coeio thread, and the
+ * calling fiber yields until it completes. Raises
+ * ER_NO_SUCH_INDEX if the index is being dropped.
+ */
+void *sophia_read(const SophiaIndex *index, void *src, void *key);
+
 extern "C" {
 int sophia_schedule(void);
 }
@@ -42,13 +42,69 @@
 #include <stdio.h>
 #include <inttypes.h>
 
-static inline int
-sophia_index_stmt(void *tx, void *db, int del, struct key_def *key_def, struct tuple *tuple)
+/**
+ * A Sophia key is the MsgPack of the indexed fields in the key
+ * part order, without an array header. A non-unique index also
+ * appends the primary key fields to make every key distinct.
+ * A search key is a prefix of it.
+ */
+static const char *
+sophia_tuple_key(struct key_def *key_def, struct key_def *pk_def,
+                 struct tuple *tuple, size_t *size)
+{
+	struct key_def *defs[2] = { key_def, pk_def };
+	*size = 0;
+	for (int d = 0; d < 2 && defs[d] != NULL; d++) {
+		for (uint32_t i = 0; i < defs[d]->part_count; i++) {
+			const char *field =
+				tuple_field(tuple, defs[d]->parts[i].fieldno);
+			const char *end = field;
+			mp_next(&end);
+			*size += end - field;
+		}
+	}
+	char *key = (char *) region_alloc(&fiber()->gc, *size);
+	char *pos = key;
+	for (int d = 0; d < 2 && defs[d] != NULL; d++) {
+		for (uint32_t i = 0; i < defs[d]->part_count; i++) {
+			const char *field =
+				tuple_field(tuple, defs[d]->parts[i].fieldno);
+			const char *end = field;
+			mp_next(&end);
+			memcpy(pos, field, end - field);
+			pos += end - field;
+		}
+	}
+	return key;
+}
+
+/** The size of a search key of part_count parts. */
+static inline size_t
+sophia_key_size(const char *key, uint32_t part_count)
 {
-	const char *key = tuple_field(tuple, key_def->parts[0].fieldno);
 	const char *keyptr = key;
-	mp_next(&keyptr);
-	size_t keysize = keyptr - key;
+	for (uint32_t i = 0; i < part_count; i++)
+		mp_next(&keyptr);
+	return keyptr - key;
+}
+
+/**
+ * The primary key definition to complete the keys of a
+ * non-unique index with, or NULL.
+ */
+static inline struct key_def *
+sophia_pk_def(struct key_def *key_def)
+{
+	if (key_def->is_unique)
+		return NULL;
+	struct space *space = space_cache_find(key_def->space_id);
+	return index_find(space, 0)->key_def;
+}
+
+static inline int
+sophia_index_stmt(void *tx, void *db, int del, const char *key,
+                  size_t keysize, struct tuple *tuple)
+{
 	void *o = sp_object(db);
 	if (o == NULL)
 		return -1;
@@ -61,14 +117,14 @@ sophia_index_stmt(void *tx, void *db, int del, struct key_def *key_def, struct t
 }
 
 static struct tuple*
-sophia_index_get(void *env, void *db, void *tx, const char *key, size_t keysize,
-                 struct tuple_format *format)
+sophia_index_get(const SophiaIndex *index, void *tx, const char *key,
+                 size_t keysize, struct tuple_format *format)
 {
-	void *o = sp_object(db);
+	void *o = sp_object(index->db);
 	if (o == NULL)
-		sophia_raise(env);
+		sophia_raise(index->env);
 	sp_set(o, "key", key, keysize);
-	void *result = sp_get((tx) ? tx: db, o);
+	void *result = sophia_read(index, (tx) ? tx: index->db, o);
 	if (result == NULL)
 		return NULL;
 	auto scoped_guard =
@@ -78,26 +134,56 @@ sophia_index_get(void *env, void *db, void *tx, const char *key, size_t keysize,
 	return tuple_new(format, (char*)value, (char*)value + valuesize);
 }
 
+/**
+ * Write a statement to all indexes of a space in one Sophia
+ * transaction. Secondary keys of the tuple being replaced
+ * have to be deleted, so a REPLACE looks it up by the primary
+ * key first.
+ */
+static void
+sophia_space_replace(struct space *space, void *tx,
+                     struct tuple *old_tuple, struct tuple *new_tuple,
+                     enum dup_replace_mode mode, bool check)
+{
+	SophiaIndex *pk = (SophiaIndex *) index_find(space, 0);
+	if (check)
+		pk->checkDup(tx, old_tuple, new_tuple, mode);
+	struct tuple *replaced = old_tuple;
+	if (replaced == NULL && mode != DUP_INSERT &&
+	    space->index_count > 1) {
+		size_t keysize;
+		const char *key = sophia_tuple_key(pk->key_def, NULL,
+						   new_tuple, &keysize);
+		replaced = sophia_index_get(pk, tx, key, keysize,
+					    space->format);
+		if (replaced != NULL)
+			tuple_ref(replaced);
+	}
+	auto replaced_guard = make_scoped_guard([=] {
+		if (replaced != NULL && replaced != old_tuple)
+			tuple_unref(replaced);
+	});
+	if (check) {
+		for (uint32_t i = 1; i < space->index_count; i++) {
+			SophiaIndex *index = (SophiaIndex *) space->index[i];
+			index->checkDup(tx, replaced, new_tuple, mode);
+		}
+	}
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		SophiaIndex *index = (SophiaIndex *) space->index[i];
+		index->writeTuple(tx, replaced, new_tuple);
+	}
+}
+
 struct tuple*
 sophia_replace_recover(struct space *space,
                        struct tuple *old_tuple, struct tuple *new_tuple,
-                       enum dup_replace_mode)
+                       enum dup_replace_mode mode)
 {
-	SophiaIndex *index = (SophiaIndex*)index_find(space, 0);
 	struct txn *txn = in_txn();
 	assert(txn != NULL && txn->engine_tx != NULL);
-	int rc;
-	if (old_tuple) {
-		rc = sophia_index_stmt(txn->engine_tx, index->db, 1,
-		                       index->key_def,
-		                       old_tuple);
-	} else {
-		rc = sophia_index_stmt(txn->engine_tx, index->db, 0,
-		                       index->key_def,
-		                       new_tuple);
-	}
-	if (rc == -1)
-		sophia_raise(index->env);
+	sophia_space_replace(space, txn->engine_tx, old_tuple, new_tuple,
+			     mode, false);
 	return NULL;
 }
 
@@ -106,20 +192,64 @@ sophia_replace(struct space *space,
                struct tuple *old_tuple, struct tuple *new_tuple,
                enum dup_replace_mode mode)
 {
-	Index *index = index_find(space, 0);
-	return index->replace(old_tuple, new_tuple, mode);
+	struct txn *txn = in_txn();
+	assert(txn != NULL && txn->engine_tx != NULL);
+	/* do not involve in tarantool transaction regarding old_tuple,
+	 * always return NULL.
+	*/
+	sophia_space_replace(space, txn->engine_tx, old_tuple, new_tuple,
+			     mode, true);
+	return NULL;
 }
 
+/**
+ * Compare two keys part by part. A search key may have fewer
+ * parts than a stored key and is equal to every key it is a
+ * prefix of: this gives ">=", ">", "<=" and "<" cursors the
+ * semantics of the partial key iterators. The primary key
+ * fields appended to a non-unique key are compared bytewise,
+ * they only need to make the keys distinct.
+ */
 static inline int
-sophia_index_compare(char *a, size_t asz __attribute__((unused)),
-                     char *b, size_t bsz __attribute__((unused)),
-                     void *arg)
+sophia_index_compare(char *a, size_t asz, char *b, size_t bsz, void *arg)
 {
 	struct key_def *key_def = (struct key_def*)arg;
+	const char *a_end = a + asz;
+	const char *b_end = b + bsz;
+	const char *pa = a;
+	const char *pb = b;
+	for (uint32_t i = 0; i < key_def->part_count; i++) {
+		if (pa == a_end || pb == b_end)
+			return 0;
+		int rc = tuple_compare_field(pa, pb, key_def->parts[i].type);
+		if (rc != 0)
+			return (rc > 0) ? 1 : -1;
+		mp_next(&pa);
+		mp_next(&pb);
+	}
+	if (pa == a_end || pb == b_end)
+		return 0;
+	size_t a_tail = a_end - pa;
+	size_t b_tail = b_end - pb;
+	int rc = memcmp(pa, pb, MIN(a_tail, b_tail));
+	if (rc == 0)
+		return (a_tail < b_tail) ? -1 : (a_tail > b_tail);
+	return (rc > 0) ? 1 : -1;
+}
 
-	int rc = tuple_compare_field(a, b, key_def->parts[0].type);
-	return (rc == 0) ? 0 :
-	       ((rc > 0) ? 1 : -1);
+/**
+ * The primary key keeps the space id as the database name,
+ * a secondary key is stored in "<space id>_<index id>".
+ */
+static inline void
+sophia_db_name(struct key_def *key_def, char *name, size_t size)
+{
+	if (key_def->iid == 0) {
+		snprintf(name, size, "%" PRIu32, key_def->space_id);
+	} else {
+		snprintf(name, size, "%" PRIu32 "_%" PRIu32,
+		         key_def->space_id, key_def->iid);
+	}
 }
 
 static inline void*
@@ -131,15 +261,15 @@ sophia_configure(struct space *space, struct key_def *key_def)
 	void *c = sp_ctl(env);
 	char pointer[128];
 	char pointer_arg[128];
+	char db_name[32];
 	char name[128];
-	snprintf(name, sizeof(name), "%" PRIu32, key_def->space_id);
-	sp_set(c, "db", name);
-	snprintf(name, sizeof(name), "db.%" PRIu32 ".index.cmp",
-	         key_def->space_id);
+	sophia_db_name(key_def, db_name, sizeof(db_name));
+	sp_set(c, "db", db_name);
+	snprintf(name, sizeof(name), "db.%s.index.cmp", db_name);
 	snprintf(pointer, sizeof(pointer), "pointer: %p", (void*)sophia_index_compare);
 	snprintf(pointer_arg, sizeof(pointer_arg), "pointer: %p", (void*)key_def);
 	sp_set(c, name, pointer, pointer_arg);
-	snprintf(name, sizeof(name), "db.%" PRIu32, key_def->space_id);
+	snprintf(name, sizeof(name), "db.%s", db_name);
 	void *db = sp_get(c, name);
 	if (db == NULL)
 		sophia_raise(env);
@@ -163,17 +293,23 @@ SophiaIndex::SophiaIndex(struct key_def *key_def_arg __attribute__((unused)))
 	int rc = sp_open(db);
 	if (rc == -1)
 		sophia_raise(env);
+	reads_in_progress = 0;
+	is_dropped = false;
+	drop_waiter = NULL;
 	tuple_format_ref(space->format, 1);
 }
 
 void
 sophia_complete_recovery(struct space *space)
 {
-	SophiaIndex *index = (SophiaIndex*)index_find(space, 0);
 	assert(space->handler->recovery.recover == space_noop);
-	int rc = sp_open(index->db);
-	if (rc == -1)
-		sophia_raise(index->env);
+	/* each index of the space is a database of its own */
+	for (uint32_t i = 0; i < space->index_count; i++) {
+		SophiaIndex *index = (SophiaIndex *) space->index[i];
+		int rc = sp_open(index->db);
+		if (rc == -1)
+			sophia_raise(index->env);
+	}
 }
 
 SophiaIndex::~SophiaIndex()
@@ -222,9 +358,10 @@ size_t
 SophiaIndex::size() const
 {
 	void *c = sp_ctl(env);
+	char db_name[32];
 	char name[128];
-	snprintf(name, sizeof(name), "db.%" PRIu32 ".index.count",
-	         key_def->space_id);
+	sophia_db_name(key_def, db_name, sizeof(db_name));
+	snprintf(name, sizeof(name), "db.%s.index.count", db_name);
 	void *o = sp_get(c, name);
 	if (o == NULL)
 		sophia_raise(env);
@@ -237,9 +374,10 @@ size_t
 SophiaIndex::memsize() const
 {
 	void *c = sp_ctl(env);
+	char db_name[32];
 	char name[128];
-	snprintf(name, sizeof(name), "db.%" PRIu32 ".index.memory_used",
-	         key_def->space_id);
+	sophia_db_name(key_def, db_name, sizeof(db_name));
+	snprintf(name, sizeof(name), "db.%s.index.memory_used", db_name);
 	void *o = sp_get(c, name);
 	if (o == NULL)
 		sophia_raise(env);
@@ -251,81 +389,93 @@ SophiaIndex::memsize() const
 struct tuple *
 SophiaIndex::findByKey(const char *key, uint32_t part_count) const
 {
-	(void) part_count;
-	assert(part_count == 1);
 	assert(key_def->is_unique && part_count == key_def->part_count);
-	const char *keyptr = key;
-	mp_next(&keyptr);
-	size_t keysize = keyptr - key;
+	size_t keysize = sophia_key_size(key, part_count);
 	struct space *space = space_cache_find(key_def->space_id);
-	return sophia_index_get(env, db, NULL, key, keysize, space->format);
+	return sophia_index_get(this, NULL, key, keysize, space->format);
 }
 
-struct tuple *
-SophiaIndex::replace(struct tuple *old_tuple, struct tuple *new_tuple,
-                     enum dup_replace_mode mode)
+void
+SophiaIndex::checkDup(void *tx, struct tuple *old_tuple,
+                      struct tuple *new_tuple,
+                      enum dup_replace_mode mode) const
 {
+	if (new_tuple == NULL || ! key_def->is_unique)
+		return;
+	/* REPLACE and UPDATE overwrite the primary key */
+	if (key_def->iid == 0 && (mode != DUP_INSERT || old_tuple != NULL))
+		return;
+	size_t keysize;
+	const char *key = sophia_tuple_key(key_def, NULL, new_tuple,
+					   &keysize);
 	struct space *space = space_cache_find(key_def->space_id);
-	struct txn *txn = in_txn();
-	assert(txn != NULL && txn->engine_tx != NULL);
-
-	/* do not involve in tarantool transaction regarding old_tuple,
-	 * always return NULL.
-	*/
+	struct tuple *dup_tuple =
+		sophia_index_get(this, tx, key, keysize, space->format);
+	if (dup_tuple == NULL)
+		return;
+	TupleGuard dup_guard(dup_tuple);
+	/* a secondary key may belong to the tuple being replaced */
+	if (key_def->iid != 0 &&
+	    tuple_compare(dup_tuple, new_tuple,
+			  index_find(space, 0)->key_def) == 0)
+		return;
+	tnt_raise(ClientError, ER_TUPLE_FOUND, index_name(this));
+}
 
-	/* delete */
+void
+SophiaIndex::writeTuple(void *tx, struct tuple *old_tuple,
+                        struct tuple *new_tuple)
+{
+	struct key_def *pk_def = sophia_pk_def(key_def);
+	const char *new_key = NULL;
+	size_t new_keysize = 0;
+	if (new_tuple) {
+		new_key = sophia_tuple_key(key_def, pk_def, new_tuple,
+					   &new_keysize);
+	}
 	int rc;
-	if (old_tuple && new_tuple == NULL) {
-		assert(old_tuple != NULL);
-		rc = sophia_index_stmt(txn->engine_tx, db, 1, key_def,
-				       old_tuple);
-		if (rc == -1)
-			sophia_raise(env);
-		return NULL;
+	if (old_tuple) {
+		size_t old_keysize;
+		const char *old_key = sophia_tuple_key(key_def, pk_def,
+						       old_tuple,
+						       &old_keysize);
+		/* the new tuple overwrites an equal key */
+		if (new_key == NULL || old_keysize != new_keysize ||
+		    memcmp(old_key, new_key, old_keysize) != 0) {
+			rc = sophia_index_stmt(tx, db, 1, old_key,
+					       old_keysize, old_tuple);
+			if (rc == -1)
+				sophia_raise(env);
+		}
 	}
-
-	/* update */
-	if (old_tuple && new_tuple) {
-		/* assume no primary key update is supported */
-		rc = sophia_index_stmt(txn->engine_tx, db, 0, key_def,
+	if (new_tuple) {
+		rc = sophia_index_stmt(tx, db, 0, new_key, new_keysize,
 				       new_tuple);
 		if (rc == -1)
 			sophia_raise(env);
-		return NULL;
 	}
+}
 
-	/* insert or replace */
-	switch (mode) {
-	case DUP_INSERT: {
-		const char *key = tuple_field(new_tuple, key_def->parts[0].fieldno);
-		const char *keyptr = key;
-		mp_next(&keyptr);
-		size_t keysize = keyptr - key;
-		struct tuple *dup_tuple =
-			sophia_index_get(env, db, txn->engine_tx, key,
-					 keysize, space->format);
-		if (dup_tuple) {
-			tuple_ref(dup_tuple);
-			int error = 0;
-			if (tuple_compare(dup_tuple, new_tuple, key_def) == 0)
-				error = 1;
-			tuple_unref(dup_tuple);
-			if (error) {
-				tnt_raise(ClientError, ER_TUPLE_FOUND, index_name(this));
-			}
-		}
-	}
-	case DUP_REPLACE_OR_INSERT:
-		rc = sophia_index_stmt(txn->engine_tx, db, 0, key_def,
-				       new_tuple);
-		if (rc == -1)
-			sophia_raise(env);
-		break;
-	case DUP_REPLACE:
-	default:
-		assert(0);
-		break;
+struct tuple *
+SophiaIndex::replace(struct tuple *old_tuple, struct tuple *new_tuple,
+                     enum dup_replace_mode mode)
+{
+	struct txn *txn = in_txn();
+	assert(txn != NULL);
+	/*
+	 * An index built on a non-empty space outside of a Sophia
+	 * transaction would get no WAL signature to be recovered
+	 * with.
+	 */
+	if (txn->engine_tx == NULL) {
+		tnt_raise(ClientError, ER_UNSUPPORTED, "Sophia",
+			  "adding an index to a non-empty space");
 	}
+	checkDup(txn->engine_tx, old_tuple, new_tuple, mode);
+	writeTuple(txn->engine_tx, old_tuple, new_tuple);
+	/* do not involve in tarantool transaction regarding old_tuple,
+	 * always return NULL.
+	*/
 	return NULL;
 }
 
@@ -334,7 +484,9 @@ struct sophia_iterator {
 	const char *key;
 	int keysize;
 	uint32_t part_count;
+	struct key_def *key_def;
 	struct space *space;
+	const SophiaIndex *index;
 	void *env;
 	void *db;
 	void *cursor;
@@ -362,18 +514,24 @@ sophia_iterator_close(struct iterator *ptr)
 	}
 }
 
+static inline struct tuple *
+sophia_iterator_tuple(struct sophia_iterator *it, void *o)
+{
+	int valuesize = 0;
+	const char *value = (const char*)sp_get(o, "value", &valuesize);
+	return tuple_new(it->space->format, value, value + valuesize);
+}
+
 struct tuple *
 sophia_iterator_next(struct iterator *ptr)
 {
 	assert(ptr->next == sophia_iterator_next);
 	struct sophia_iterator *it = (struct sophia_iterator *) ptr;
 	assert(it->cursor != NULL);
-	void *o = sp_get(it->cursor);
+	void *o = sophia_read(it->index, it->cursor, NULL);
 	if (o == NULL)
 		return NULL;
-	int valuesize = 0;
-	const char *value = (const char*)sp_get(o, "value", &valuesize);
-	return tuple_new(it->space->format, value, value + valuesize);
+	return sophia_iterator_tuple(it, o);
 }
 
 struct tuple *
@@ -382,13 +540,36 @@ sophia_iterator_last(struct iterator *ptr __attribute__((unused)))
 	return NULL;
 }
 
+/**
+ * EQ by a partial key, or by a key of a non-unique index:
+ * scan forward while the key prefix matches.
+ */
+struct tuple *
+sophia_iterator_prefix(struct iterator *ptr)
+{
+	assert(ptr->next == sophia_iterator_prefix);
+	struct sophia_iterator *it = (struct sophia_iterator *) ptr;
+	assert(it->cursor != NULL);
+	void *o = sophia_read(it->index, it->cursor, NULL);
+	if (o == NULL)
+		return NULL;
+	int keysize = 0;
+	char *key = (char *)sp_get(o, "key", &keysize);
+	if (sophia_index_compare(key, keysize, (char *)it->key,
+	                         it->keysize, it->key_def) != 0) {
+		ptr->next = sophia_iterator_last;
+		return NULL;
+	}
+	return sophia_iterator_tuple(it, o);
+}
+
 struct tuple *
 sophia_iterator_eq(struct iterator *ptr)
 {
 	ptr->next = sophia_iterator_last;
 	struct sophia_iterator *it = (struct sophia_iterator *) ptr;
 	assert(it->cursor == NULL);
-	return sophia_index_get(it->env, it->db, it->tx, it->key, it->keysize,
+	return sophia_index_get(it->index, it->tx, it->key, it->keysize,
 	                        it->space->format);
 }
 
@@ -415,19 +596,22 @@ SophiaIndex::initIterator(struct iterator *ptr,
                           const char *key, uint32_t part_count) const
 {
 	struct sophia_iterator *it = (struct sophia_iterator *) ptr;
-	assert(it->cursor == NULL);
+	/* the iterator may be re-initialized to resume a scan */
+	sophia_iterator_close(ptr);
 	size_t keysize;
 	if (part_count > 0) {
-		const char *keyptr = key;
-		mp_next(&keyptr);
-		keysize = keyptr - key;
+		keysize = sophia_key_size(key, part_count);
 	} else {
 		keysize = 0;
 		key = NULL;
+		if (type == ITER_EQ)
+			type = ITER_ALL;
 	}
 	it->key = key;
 	it->keysize = keysize;
 	it->part_count = part_count;
+	it->key_def = key_def;
+	it->index = this;
 	it->env = env;
 	it->db = db;
 	it->space = space_cache_find(key_def->space_id);
@@ -435,9 +619,13 @@ SophiaIndex::initIterator(struct iterator *ptr,
 	const char *compare;
 	switch (type) {
 	case ITER_EQ:
-		it->base.next = sophia_iterator_eq;
-		it->tx = in_txn() ? in_txn()->engine_tx : NULL;
-		return;
+		if (key_def->is_unique && part_count == key_def->part_count) {
+			it->base.next = sophia_iterator_eq;
+			it->tx = in_txn() ? in_txn()->engine_tx : NULL;
+			return;
+		}
+		compare = ">=";
+		break;
 	case ITER_ALL:
 	case ITER_GE: compare = ">=";
 		break;
@@ -451,7 +639,8 @@ SophiaIndex::initIterator(struct iterator *ptr,
 		tnt_raise(ClientError, ER_UNSUPPORTED,
 		          "SophiaIndex", "requested iterator type");
 	}
-	it->base.next = sophia_iterator_next;
+	it->base.next = (type == ITER_EQ) ? sophia_iterator_prefix :
+	                                    sophia_iterator_next;
 	void *o = sp_object(db);
 	if (o == NULL)
 		sophia_raise(env);
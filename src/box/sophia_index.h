@@ -48,8 +48,25 @@ public:
 				  const char *key, uint32_t part_count) const;
 	virtual size_t memsize() const;
 
+	/**
+	 * Raise ER_TUPLE_FOUND if the new tuple would duplicate
+	 * a key of another tuple in this unique index.
+	 */
+	void checkDup(void *tx, struct tuple *old_tuple,
+		      struct tuple *new_tuple,
+		      enum dup_replace_mode mode) const;
+	/** Replace the key of old_tuple with the key of new_tuple. */
+	void writeTuple(void *tx, struct tuple *old_tuple,
+			struct tuple *new_tuple);
+
 	void *env;
 	void *db;
+	/** The number of sophia_read() calls on the database. */
+	mutable int reads_in_progress;
+	/** Set by dropIndex(): no new reads are started. */
+	bool is_dropped;
+	/** The fiber waiting in dropIndex() for reads to end. */
+	struct fiber *drop_waiter;
 };
 
 struct tuple *
@@ -35,6 +35,7 @@
 #include "user_def.h"
 #include "user.h"
 #include "session.h"
+#include "memtx_engine.h"
 
 void
 access_check_space(struct space *space, uint8_t access)
@@ -101,6 +102,8 @@ space_new(struct space_def *def, struct rlist *key_list)
 	space->index_id_max = index_id_max;
 	/* init space engine instance */
 	Engine *engine = engine_find(def->engine_name);
+	space->format->is_transient =
+		engine_transient_tuples(engine->flags);
 	space->handler = engine->open();
 	/* fill space indexes */
 	rlist_foreach_entry(key_def, key_list, link) {
@@ -204,6 +207,7 @@ space_replace_all_keys(struct space *space, struct tuple *old_tuple,
 			Index *index = space->index[i];
 			index->replace(old_tuple, new_tuple, DUP_INSERT);
 		}
+		memtx_checkpoint_replace(space, old_tuple, new_tuple);
 		return old_tuple;
 	} catch (Exception *e) {
 		/* Rollback all changes */
@@ -224,6 +228,53 @@ space_size(struct space *space)
 	return space_index(space, 0)->size();
 }
 
+enum {
+	/** Max number of threads sorting secondary keys. */
+	SPACE_SORT_THREADS_MAX = 8,
+	/** Min space size to sort secondary keys in parallel. */
+	SPACE_SORT_PARALLEL_MIN = 100000,
+};
+
+static void *
+space_sort_key_f(void *arg)
+{
+	Index *index = (Index *) arg;
+	index->sortBuild();
+	return NULL;
+}
+
+/**
+ * Sort tuples of all secondary keys, added with
+ * index_build_fill(), in parallel. Secondary keys of
+ * a space only read tuples, which don't change until the
+ * end of the build, so each key is sorted in its own
+ * thread, while the first one is sorted by the caller.
+ * Index memory is allocated only in endBuild(), in tx.
+ */
+static void
+space_sort_secondary_keys(struct space *space, uint32_t n_tuples)
+{
+	struct cord workers[SPACE_SORT_THREADS_MAX];
+	uint32_t j = 1;
+	while (j < space->index_count) {
+		Index *index = space->index[j++];
+		int n_workers = 0;
+		while (n_tuples >= SPACE_SORT_PARALLEL_MIN &&
+		       n_workers < SPACE_SORT_THREADS_MAX &&
+		       j < space->index_count) {
+			if (cord_start(&workers[n_workers], "sort",
+				       space_sort_key_f,
+				       space->index[j]) != 0)
+				break;
+			n_workers++;
+			j++;
+		}
+		index->sortBuild();
+		for (int i = 0; i < n_workers; i++)
+			cord_join(&workers[i]);
+	}
+}
+
 /**
  * Secondary indexes are built in bulk after all data is
  * recovered. This function enables secondary keys on a space.
@@ -243,7 +294,12 @@ space_build_secondary_keys(struct space *space)
 		}
 
 		for (uint32_t j = 1; j < space->index_count; j++)
-			index_build(space->index[j], pk);
+			index_build_fill(space->index[j], pk);
+
+		space_sort_secondary_keys(space, n_tuples);
+
+		for (uint32_t j = 1; j < space->index_count; j++)
+			space->index[j]->endBuild();
 
 		if (n_tuples > 0) {
 			say_info("Space '%s': done", space_name(space));
@@ -259,6 +315,7 @@ space_build_secondary_keys(struct space *space)
 void
 space_end_build_primary_key(struct space *space)
 {
+	space->index[0]->sortBuild();
 	space->index[0]->endBuild();
 	engine_recovery *r = &space->handler->recovery;
 	r->state   = READY_PRIMARY_KEY;
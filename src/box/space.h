@@ -32,6 +32,7 @@
 #include "key_def.h"
 #include "engine.h"
 #include "salad/rlist.h"
+#include "histogram.h"
 
 struct space {
 	struct access access[BOX_USER_MAX];
@@ -66,6 +67,8 @@ struct space {
 
 	/** Default tuple format used by this space */
 	struct tuple_format *format;
+	/** Execution time of data change requests on this space. */
+	struct histogram latency;
 	/**
 	 * Sparse array of indexes defined on the space, indexed
 	 * by id. Used to quickly find index by id (for SELECTs).
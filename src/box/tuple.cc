@@ -30,6 +30,7 @@
 
 #include "small/small.h"
 #include "small/quota.h"
+#include "memory.h"
 
 #include "key_def.h"
 #include "tuple_update.h"
@@ -50,6 +51,10 @@ struct slab_arena memtx_arena;
 static struct slab_cache memtx_slab_cache;
 struct small_alloc memtx_alloc;
 
+/** Transient tuples, see tuple_format::is_transient. */
+static struct slab_cache transient_slab_cache;
+static struct small_alloc transient_alloc;
+
 enum {
 	/** Lowest allowed slab_alloc_minimal */
 	OBJSIZE_MIN = 16,
@@ -159,6 +164,7 @@ tuple_format_alloc(struct rlist *key_list)
 
 	format->refs = 0;
 	format->id = FORMAT_ID_NIL;
+	format->is_transient = false;
 	format->max_fieldno = max_fieldno;
 	format->field_count = field_count;
 	format->types = (enum field_type *)
@@ -262,7 +268,9 @@ struct tuple *
 tuple_alloc(struct tuple_format *format, size_t size)
 {
 	size_t total = sizeof(struct tuple) + size + format->field_map_size;
-	char *ptr = (char *) smalloc(&memtx_alloc, total, "tuple");
+	struct small_alloc *alloc = format->is_transient ?
+		&transient_alloc : &memtx_alloc;
+	char *ptr = (char *) smalloc(alloc, total, "tuple");
 	struct tuple *tuple = (struct tuple *)(ptr + format->field_map_size);
 
 	tuple->refs = 0;
@@ -288,7 +296,10 @@ tuple_delete(struct tuple *tuple)
 	size_t total = sizeof(struct tuple) + tuple->bsize + format->field_map_size;
 	char *ptr = (char *) tuple - format->field_map_size;
 	tuple_format_ref(format, -1);
-	if (!memtx_alloc.is_delayed_free_mode || tuple->version == snapshot_version)
+	if (format->is_transient)
+		smfree(&transient_alloc, ptr, total);
+	else if (!memtx_alloc.is_delayed_free_mode ||
+		 tuple->version == snapshot_version)
 		smfree(&memtx_alloc, ptr, total);
 	else
 		smfree_delayed(&memtx_alloc, ptr, total);
@@ -458,36 +469,6 @@ tuple_compare_field(const char *field_a, const char *field_b,
 	} /* end switch */
 }
 
-int
-tuple_compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
-	      const struct key_def *key_def)
-{
-	if (key_def->part_count == 1 && key_def->parts[0].fieldno == 0) {
-		const char *a = tuple_a->data;
-		const char *b = tuple_b->data;
-		mp_decode_array(&a);
-		mp_decode_array(&b);
-		return tuple_compare_field(a, b, key_def->parts[0].type);
-	}
-
-	const struct key_part *part = key_def->parts;
-	const struct key_part *end = part + key_def->part_count;
-	struct tuple_format *format_a = tuple_format(tuple_a);
-	struct tuple_format *format_b = tuple_format(tuple_b);
-	const char *field_a;
-	const char *field_b;
-	int r = 0;
-
-	for (; part < end; part++) {
-		field_a = tuple_field_old(format_a, tuple_a, part->fieldno);
-		field_b = tuple_field_old(format_b, tuple_b, part->fieldno);
-		assert(field_a != NULL && field_b != NULL);
-		if ((r = tuple_compare_field(field_a, field_b, part->type)))
-			break;
-	}
-	return r;
-}
-
 int
 tuple_compare_dup(const struct tuple *tuple_a, const struct tuple *tuple_b,
 		  const struct key_def *key_def)
@@ -499,34 +480,6 @@ tuple_compare_dup(const struct tuple *tuple_a, const struct tuple *tuple_b,
 	return r;
 }
 
-int
-tuple_compare_with_key(const struct tuple *tuple, const char *key,
-		       uint32_t part_count, const struct key_def *key_def)
-{
-	assert(key != NULL || part_count == 0);
-	assert(part_count <= key_def->part_count);
-	struct tuple_format *format = tuple_format(tuple);
-	if (likely(part_count == 1)) {
-		const struct key_part *part = key_def->parts;
-		const char *field = tuple_field_old(format, tuple,
-						    part->fieldno);
-		return tuple_compare_field(field, key, part->type);
-	}
-
-	const struct key_part *part = key_def->parts;
-	const struct key_part *end = part + MIN(part_count, key_def->part_count);
-	int r = 0; /* Part count can be 0 in wildcard searches. */
-	for (; part < end; part++) {
-		const char *field = tuple_field_old(format, tuple,
-						    part->fieldno);
-		r = tuple_compare_field(field, key, part->type);
-		if (r != 0)
-			break;
-		mp_next(&key);
-	}
-	return r;
-}
-
 void
 tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
 	   uint32_t objsize_max, float alloc_factor)
@@ -576,6 +529,9 @@ tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
 	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
 			   objsize_min, alloc_factor);
+	slab_cache_create(&transient_slab_cache, &runtime);
+	small_alloc_create(&transient_alloc, &transient_slab_cache,
+			   objsize_min, alloc_factor);
 }
 
 void
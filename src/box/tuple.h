@@ -76,6 +76,12 @@ struct tuple_format {
 	 * tuple, *in bytes*.
 	 */
 	uint32_t field_map_size;
+	/**
+	 * Tuples of this format are transient copies of the
+	 * data stored by a disk engine. They are allocated
+	 * from the runtime arena and do not take memtx memory.
+	 */
+	bool is_transient;
 	/**
 	 * For each field participating in an index, the format
 	 * may either store the fixed offset of the field
@@ -477,9 +483,12 @@ tuple_compare_field(const char *field_a, const char *field_b,
  * @retval <0 if key_fields(tuple_a) < key_fields(tuple_b)
  * @retval >0 if key_fields(tuple_a) > key_fields(tuple_b)
  */
-int
+inline int
 tuple_compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
-	      const struct key_def *key_def);
+	      const struct key_def *key_def)
+{
+	return key_def->tuple_compare(tuple_a, tuple_b, key_def);
+}
 
 /**
  * @brief Compare two tuples field by field for duplicate using key definition
@@ -505,9 +514,13 @@ tuple_compare_dup(const struct tuple *tuple_a, const struct tuple *tuple_b,
  * @retval <0 if key_fields(tuple_a) < parts(key)
  * @retval >0 if key_fields(tuple_a) > parts(key)
  */
-int
+inline int
 tuple_compare_with_key(const struct tuple *tuple_a, const char *key,
-		       uint32_t part_count, const struct key_def *key_def);
+		       uint32_t part_count, const struct key_def *key_def)
+{
+	return key_def->tuple_compare_with_key(tuple_a, key, part_count,
+					       key_def);
+}
 
 /** These functions are implemented in tuple_convert.cc. */
 
@@ -0,0 +1,344 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "tuple.h"
+
+/* {{{ Generic comparators */
+
+static int
+tuple_compare_slowpath(const struct tuple *tuple_a,
+		       const struct tuple *tuple_b,
+		       const struct key_def *key_def)
+{
+	if (key_def->part_count == 1 && key_def->parts[0].fieldno == 0) {
+		const char *a = tuple_a->data;
+		const char *b = tuple_b->data;
+		mp_decode_array(&a);
+		mp_decode_array(&b);
+		return tuple_compare_field(a, b, key_def->parts[0].type);
+	}
+
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + key_def->part_count;
+	struct tuple_format *format_a = tuple_format(tuple_a);
+	struct tuple_format *format_b = tuple_format(tuple_b);
+	const char *field_a;
+	const char *field_b;
+	int r = 0;
+
+	for (; part < end; part++) {
+		field_a = tuple_field_old(format_a, tuple_a, part->fieldno);
+		field_b = tuple_field_old(format_b, tuple_b, part->fieldno);
+		assert(field_a != NULL && field_b != NULL);
+		if ((r = tuple_compare_field(field_a, field_b, part->type)))
+			break;
+	}
+	return r;
+}
+
+static int
+tuple_compare_with_key_slowpath(const struct tuple *tuple, const char *key,
+				uint32_t part_count,
+				const struct key_def *key_def)
+{
+	assert(key != NULL || part_count == 0);
+	assert(part_count <= key_def->part_count);
+	struct tuple_format *format = tuple_format(tuple);
+	if (likely(part_count == 1)) {
+		const struct key_part *part = key_def->parts;
+		const char *field = tuple_field_old(format, tuple,
+						    part->fieldno);
+		return tuple_compare_field(field, key, part->type);
+	}
+
+	const struct key_part *part = key_def->parts;
+	const struct key_part *end = part + MIN(part_count, key_def->part_count);
+	int r = 0; /* Part count can be 0 in wildcard searches. */
+	for (; part < end; part++) {
+		const char *field = tuple_field_old(format, tuple,
+						    part->fieldno);
+		r = tuple_compare_field(field, key, part->type);
+		if (r != 0)
+			break;
+		mp_next(&key);
+	}
+	return r;
+}
+
+/* }}} */
+
+/* {{{ Comparators specialized for key parts */
+
+/**
+ * The most popular keys get comparators generated from the
+ * templates below, for a fixed list of (field no, field type)
+ * pairs. Such a comparator has no loop over the key parts
+ * and no switch on the field type. Besides, the fields of
+ * adjacent parts are found by skipping the previous field
+ * rather than through the field map.
+ */
+
+/** Compare two fields of the given type. */
+template <int TYPE>
+static inline int
+field_compare(const char *field_a, const char *field_b);
+
+template <>
+inline int
+field_compare<NUM>(const char *field_a, const char *field_b)
+{
+	return mp_compare_uint(field_a, field_b);
+}
+
+template <>
+inline int
+field_compare<STRING>(const char *field_a, const char *field_b)
+{
+	uint32_t size_a = mp_decode_strl(&field_a);
+	uint32_t size_b = mp_decode_strl(&field_b);
+	int r = memcmp(field_a, field_b, MIN(size_a, size_b));
+	if (r == 0)
+		r = size_a < size_b ? -1 : size_a > size_b;
+	return r;
+}
+
+/** Compare two fields of the given type and skip them. */
+template <int TYPE>
+static inline int
+field_compare_and_next(const char **field_a, const char **field_b);
+
+template <>
+inline int
+field_compare_and_next<NUM>(const char **field_a, const char **field_b)
+{
+	uint64_t a = mp_decode_uint(field_a);
+	uint64_t b = mp_decode_uint(field_b);
+	return a < b ? -1 : a > b;
+}
+
+template <>
+inline int
+field_compare_and_next<STRING>(const char **field_a, const char **field_b)
+{
+	uint32_t size_a = mp_decode_strl(field_a);
+	uint32_t size_b = mp_decode_strl(field_b);
+	int r = memcmp(*field_a, *field_b, MIN(size_a, size_b));
+	if (r == 0)
+		r = size_a < size_b ? -1 : size_a > size_b;
+	*field_a += size_a;
+	*field_b += size_b;
+	return r;
+}
+
+/**
+ * Compare the fields of two tuples starting from the part
+ * on field FIELDNO of type TYPE. MORE_PARTS are the
+ * (field no, type) pairs of the remaining parts.
+ */
+template <int FIELDNO, int TYPE, int ...MORE_PARTS>
+struct FieldCompare;
+
+template <int FIELDNO, int TYPE, int NEXT_FIELDNO, int NEXT_TYPE,
+	  int ...MORE_PARTS>
+struct FieldCompare<FIELDNO, TYPE, NEXT_FIELDNO, NEXT_TYPE, MORE_PARTS...> {
+	static inline int
+	compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
+		const struct tuple_format *format_a,
+		const struct tuple_format *format_b,
+		const char *field_a, const char *field_b)
+	{
+		int r;
+		if (FIELDNO + 1 == NEXT_FIELDNO) {
+			r = field_compare_and_next<TYPE>(&field_a, &field_b);
+			if (r != 0)
+				return r;
+		} else {
+			r = field_compare<TYPE>(field_a, field_b);
+			if (r != 0)
+				return r;
+			field_a = tuple_field_old(format_a, tuple_a,
+						  NEXT_FIELDNO);
+			field_b = tuple_field_old(format_b, tuple_b,
+						  NEXT_FIELDNO);
+		}
+		return FieldCompare<NEXT_FIELDNO, NEXT_TYPE, MORE_PARTS...>::
+			compare(tuple_a, tuple_b, format_a, format_b,
+				field_a, field_b);
+	}
+};
+
+template <int FIELDNO, int TYPE>
+struct FieldCompare<FIELDNO, TYPE> {
+	static inline int
+	compare(const struct tuple *, const struct tuple *,
+		const struct tuple_format *, const struct tuple_format *,
+		const char *field_a, const char *field_b)
+	{
+		return field_compare<TYPE>(field_a, field_b);
+	}
+};
+
+/** @copydoc tuple_compare() for a key of the given parts. */
+template <int FIELDNO, int TYPE, int ...MORE_PARTS>
+struct TupleCompare {
+	static int
+	compare(const struct tuple *tuple_a, const struct tuple *tuple_b,
+		const struct key_def *)
+	{
+		struct tuple_format *format_a = tuple_format(tuple_a);
+		struct tuple_format *format_b = tuple_format(tuple_b);
+		const char *field_a = tuple_field_old(format_a, tuple_a,
+						      FIELDNO);
+		const char *field_b = tuple_field_old(format_b, tuple_b,
+						      FIELDNO);
+		return FieldCompare<FIELDNO, TYPE, MORE_PARTS...>::
+			compare(tuple_a, tuple_b, format_a, format_b,
+				field_a, field_b);
+	}
+};
+
+/**
+ * Compare the fields of a tuple with a key starting from the
+ * part on field FIELDNO of type TYPE. part_count is the
+ * number of key parts left, including this one.
+ */
+template <int FIELDNO, int TYPE, int ...MORE_PARTS>
+struct FieldCompareWithKey;
+
+template <int FIELDNO, int TYPE, int NEXT_FIELDNO, int NEXT_TYPE,
+	  int ...MORE_PARTS>
+struct FieldCompareWithKey<FIELDNO, TYPE, NEXT_FIELDNO, NEXT_TYPE,
+			   MORE_PARTS...> {
+	static inline int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct tuple_format *format,
+		const char *field)
+	{
+		int r = field_compare_and_next<TYPE>(&field, &key);
+		if (r != 0 || part_count == 1)
+			return r;
+		if (FIELDNO + 1 != NEXT_FIELDNO)
+			field = tuple_field_old(format, tuple, NEXT_FIELDNO);
+		return FieldCompareWithKey<NEXT_FIELDNO, NEXT_TYPE,
+					   MORE_PARTS...>::
+			compare(tuple, key, part_count - 1, format, field);
+	}
+};
+
+template <int FIELDNO, int TYPE>
+struct FieldCompareWithKey<FIELDNO, TYPE> {
+	static inline int
+	compare(const struct tuple *, const char *key, uint32_t,
+		const struct tuple_format *, const char *field)
+	{
+		return field_compare<TYPE>(field, key);
+	}
+};
+
+/** @copydoc tuple_compare_with_key() for a key of the given parts. */
+template <int FIELDNO, int TYPE, int ...MORE_PARTS>
+struct TupleCompareWithKey {
+	static int
+	compare(const struct tuple *tuple, const char *key,
+		uint32_t part_count, const struct key_def *key_def)
+	{
+		(void) key_def;
+		assert(key != NULL || part_count == 0);
+		assert(part_count <= key_def->part_count);
+		/* Part count can be 0 in wildcard searches. */
+		if (part_count == 0)
+			return 0;
+		struct tuple_format *format = tuple_format(tuple);
+		const char *field = tuple_field_old(format, tuple, FIELDNO);
+		return FieldCompareWithKey<FIELDNO, TYPE, MORE_PARTS...>::
+			compare(tuple, key, part_count, format, field);
+	}
+};
+
+/** A list of key parts and the comparators generated for it. */
+struct tuple_compare_signature {
+	tuple_compare_t tuple_compare;
+	tuple_compare_with_key_t tuple_compare_with_key;
+	/**
+	 * (field no, field type) pairs of up to 3 parts,
+	 * UINT32_MAX terminated.
+	 */
+	uint32_t parts[3 * 2 + 1];
+};
+
+#define COMPARATOR(...) {						\
+	TupleCompare<__VA_ARGS__>::compare,				\
+	TupleCompareWithKey<__VA_ARGS__>::compare,			\
+	{ __VA_ARGS__, UINT32_MAX }					\
+},
+
+static const struct tuple_compare_signature tuple_compare_signatures[] = {
+	COMPARATOR(0, NUM)
+	COMPARATOR(0, STRING)
+	COMPARATOR(1, NUM)
+	COMPARATOR(1, STRING)
+	COMPARATOR(0, NUM, 1, NUM)
+	COMPARATOR(0, NUM, 1, STRING)
+	COMPARATOR(0, STRING, 1, NUM)
+	COMPARATOR(0, STRING, 1, STRING)
+	COMPARATOR(0, NUM, 1, NUM, 2, NUM)
+	COMPARATOR(0, NUM, 1, NUM, 2, STRING)
+	COMPARATOR(0, NUM, 1, STRING, 2, NUM)
+	COMPARATOR(0, NUM, 1, STRING, 2, STRING)
+	COMPARATOR(0, STRING, 1, NUM, 2, NUM)
+	COMPARATOR(0, STRING, 1, NUM, 2, STRING)
+	COMPARATOR(0, STRING, 1, STRING, 2, NUM)
+	COMPARATOR(0, STRING, 1, STRING, 2, STRING)
+};
+
+#undef COMPARATOR
+
+/* }}} */
+
+void
+key_def_set_compare(struct key_def *def)
+{
+	def->tuple_compare = tuple_compare_slowpath;
+	def->tuple_compare_with_key = tuple_compare_with_key_slowpath;
+	for (uint32_t k = 0; k < lengthof(tuple_compare_signatures); k++) {
+		const struct tuple_compare_signature *sig =
+			&tuple_compare_signatures[k];
+		uint32_t i = 0;
+		for (; i < def->part_count; i++) {
+			if (sig->parts[i * 2] != def->parts[i].fieldno ||
+			    sig->parts[i * 2 + 1] != def->parts[i].type)
+				break;
+		}
+		if (i == def->part_count && sig->parts[i * 2] == UINT32_MAX) {
+			def->tuple_compare = sig->tuple_compare;
+			def->tuple_compare_with_key =
+				sig->tuple_compare_with_key;
+			return;
+		}
+	}
+}
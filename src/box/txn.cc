@@ -41,6 +41,7 @@
 #include "iproto_constants.h"
 
 double too_long_threshold;
+struct histogram latency_wal;
 
 static inline void
 fiber_set_txn(struct fiber *fiber, struct txn *txn)
@@ -210,19 +211,31 @@ txn_commit(struct txn *txn)
 	trigger_clear(&txn->fiber_on_yield);
 	trigger_clear(&txn->fiber_on_stop);
 
+	/*
+	 * Collect redo rows of all statements and hand them
+	 * over to the WAL writer in a single request.
+	 */
+	struct xrow_header **rows = (struct xrow_header **)
+		region_alloc(&fiber()->gc,
+			     sizeof(struct xrow_header *) * txn->n_stmts);
+	int row_count = 0;
 	rlist_foreach_entry(stmt, &txn->stmts, next) {
 		if ((!stmt->old_tuple && !stmt->new_tuple) ||
 		    space_is_temporary(stmt->space))
 			continue;
 		/* txn_commit() must be done after txn_add_redo() */
 		assert(recovery->wal_mode == WAL_NONE || stmt->row != NULL);
-		ev_tstamp start = ev_now(loop()), stop;
-		int64_t res = wal_write(recovery, stmt->row);
-		stop = ev_now(loop());
-		if (stop - start > too_long_threshold && stmt->row != NULL) {
+		rows[row_count++] = stmt->row;
+	}
+	if (row_count > 0) {
+		int64_t start = clock_monotonic64();
+		int64_t res = wal_writev(recovery, rows, row_count);
+		int64_t elapsed = clock_monotonic64() - start;
+		histogram_collect(&latency_wal, elapsed);
+		if (elapsed > too_long_threshold * 1e9 && rows[0] != NULL) {
 			say_warn("too long %s: %.3f sec",
-				 iproto_type_name(stmt->row->type),
-				 stop - start);
+				 iproto_type_name(rows[0]->type),
+				 elapsed / 1e9);
 		}
 		if (res < 0)
 			tnt_raise(LoggedError, ER_WAL_IO);
@@ -31,8 +31,11 @@
 #include "index.h"
 #include "trigger.h"
 #include "fiber.h"
+#include "histogram.h"
 
 extern double too_long_threshold;
+/** Time spent waiting for WAL writes, per transaction. */
+extern struct histogram latency_wal;
 struct tuple;
 struct space;
 
@@ -30,6 +30,8 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <sys/stat.h>
+#include <zlib.h>
 
 #include "fiber.h"
 #include "crc32.h"
@@ -51,8 +53,11 @@ typedef uint32_t log_magic_t;
 
 static const log_magic_t row_marker = mp_bswap_u32(0xd5ba0bab); /* host byte order */
 static const log_magic_t eof_marker = mp_bswap_u32(0xd510aded); /* host byte order */
+static const log_magic_t block_marker = mp_bswap_u32(0xd5ba0bbc); /* host byte order */
 static const char inprogress_suffix[] = ".inprogress";
 static const char v12[] = "0.12\n";
+/** Same as v12, but rows may be written in compressed blocks. */
+static const char v13[] = "0.13\n";
 
 XlogError::XlogError(const char *file, unsigned line,
 		     const char *format, ...)
@@ -355,81 +360,292 @@ format_filename(struct xdir *dir, int64_t signature,
 /* {{{ struct xlog_cursor */
 
 /**
+ * Decode a fixed header of a row or a block, the magic
+ * excluded.
+ *
+ * @retval 0 success
+ * @retval -1 the header is malformed
+ */
+static int
+xlog_decode_fixheader(const char *fixheader, size_t size, uint32_t *len,
+		      uint32_t *crc32p, uint32_t *crc32c)
+{
+	const char *data = fixheader;
+	if (mp_check(&data, data + size) != 0)
+		return -1;
+	data = fixheader;
+
+	/* Read length */
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*len = mp_decode_uint(&data);
+
+	/* Read previous crc32 */
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*crc32p = mp_decode_uint(&data);
+
+	/* Read current crc32 */
+	if (mp_typeof(*data) != MP_UINT)
+		return -1;
+	*crc32c = mp_decode_uint(&data);
+	assert(data <= fixheader + size);
+	return 0;
+}
+
+/** File offset of the unread data of the cursor. */
+static inline off_t
+xlog_cursor_offset(struct xlog_cursor *i)
+{
+	return i->rend_offset - (i->rend - i->rpos);
+}
+
+/**
+ * The size of the read-ahead buffer of a new cursor: the rest
+ * of the file, but no less than XLOG_READ_AHEAD_MIN and no more
+ * than XLOG_READ_AHEAD. The relay and hot standby reopen a
+ * cursor on the current WAL every time they look for new rows,
+ * and shouldn't allocate a chunk much larger than the rows.
+ */
+static size_t
+xlog_cursor_read_ahead(struct xlog_cursor *i)
+{
+	struct stat st;
+	int fd = fileno(i->log->f);
+	if (fd < 0 || fstat(fd, &st) != 0)
+		return XLOG_READ_AHEAD;
+	off_t rest = st.st_size - i->rend_offset;
+	if (rest < XLOG_READ_AHEAD_MIN)
+		return XLOG_READ_AHEAD_MIN;
+	return MIN(rest, (off_t) XLOG_READ_AHEAD);
+}
+
+/**
+ * Make at least @a size bytes of unread data available in the
+ * read-ahead buffer. The file is read in large chunks, so that
+ * most rows are decoded in place without a read of their own.
+ * Pointers to the unread data are invalidated.
+ *
+ * @retval 0 success
+ * @retval 1 EOF
+ */
+static int
+xlog_cursor_fill(struct xlog_cursor *i, size_t size)
+{
+	size_t unread = i->rend - i->rpos;
+	if (unread >= size)
+		return 0;
+
+	size_t capacity = i->rbuf_capacity;
+	if (capacity == 0)
+		capacity = xlog_cursor_read_ahead(i);
+	while (capacity < size)
+		capacity *= 2;
+	if (capacity > i->rbuf_capacity) {
+		char *rbuf = (char *) malloc(capacity);
+		if (rbuf == NULL) {
+			tnt_raise(OutOfMemory, capacity, "malloc",
+				  "xlog read buffer");
+		}
+		if (unread > 0)
+			memcpy(rbuf, i->rpos, unread);
+		free(i->rbuf);
+		i->rbuf = rbuf;
+		i->rbuf_capacity = capacity;
+	} else if (unread > 0) {
+		memmove(i->rbuf, i->rpos, unread);
+	}
+	i->rpos = i->rbuf;
+	i->rend = i->rbuf + unread;
+
+	FILE *f = i->log->f;
+	size_t n = fread(i->rbuf + unread, 1, capacity - unread, f);
+	if (n == 0 && ferror(f)) {
+		tnt_raise(SystemError, "%s: failed to read log file",
+			  i->log->filename);
+	}
+	i->rend += n;
+	i->rend_offset += n;
+	return unread + n < size;
+}
+
+/**
+ * Decode a row at the read position of the cursor. The row
+ * body is not copied and stays valid until the next read.
+ *
  * @retval 0 success
  * @retval 1 EOF
  */
 static int
-row_reader(FILE *f, struct xrow_header *row)
+row_reader(struct xlog_cursor *i, struct xrow_header *row)
 {
-	const char *data;
+	uint32_t len, crc32p, crc32c;
 
 	/* Read fixed header */
-	char fixheader[XLOG_FIXHEADER_SIZE - sizeof(log_magic_t)];
-	if (fread(fixheader, sizeof(fixheader), 1, f) != 1) {
-		if (feof(f))
-			return 1;
-error:
+	if (xlog_cursor_fill(i, XLOG_FIXHEADER_SIZE) != 0)
+		return 1;
+
+	/* Decode len, previous crc32 and row crc32 */
+	if (xlog_decode_fixheader(i->rpos + sizeof(log_magic_t),
+				  XLOG_FIXHEADER_SIZE - sizeof(log_magic_t),
+				  &len, &crc32p, &crc32c) != 0) {
 		char buf[PATH_MAX];
 		snprintf(buf, sizeof(buf), "%s: failed to read or parse row header"
-			 " at offset %" PRIu64, fio_filename(fileno(f)),
-			 (uint64_t) ftello(f));
+			 " at offset %" PRIu64, i->log->filename,
+			 (uint64_t) xlog_cursor_offset(i));
 		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
 	}
-
-	/* Decode len, previous crc32 and row crc32 */
-	data = fixheader;
-	if (mp_check(&data, data + sizeof(fixheader)) != 0)
-		goto error;
-	data = fixheader;
-
-	/* Read length */
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-	uint32_t len = mp_decode_uint(&data);
 	if (len > IPROTO_BODY_LEN_MAX) {
 		char buf[PATH_MAX];
 		snprintf(buf, sizeof(buf),
 			 "%s: row is too big at offset %" PRIu64,
-			 fio_filename(fileno(f)), (uint64_t) ftello(f));
+			 i->log->filename, (uint64_t) xlog_cursor_offset(i));
 		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
 	}
-
-	/* Read previous crc32 */
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-
-	/* Read current crc32 */
-	uint32_t crc32p = mp_decode_uint(&data);
-	if (mp_typeof(*data) != MP_UINT)
-		goto error;
-	uint32_t crc32c = mp_decode_uint(&data);
-	assert(data <= fixheader + sizeof(fixheader));
 	(void) crc32p;
 
-	/* Allocate memory for body */
-	char *bodybuf = (char *) region_alloc(&fiber()->gc, len);
-
 	/* Read header and body */
-	if (fread(bodybuf, len, 1, f) != 1)
+	if (xlog_cursor_fill(i, XLOG_FIXHEADER_SIZE + len) != 0)
 		return 1;
+	const char *data = i->rpos + XLOG_FIXHEADER_SIZE;
 
 	/* Validate checksum */
-	if (crc32_calc(0, bodybuf, len) != crc32c) {
+	if (crc32_calc(0, data, len) != crc32c) {
 		char buf[PATH_MAX];
 
 		snprintf(buf, sizeof(buf), "%s: row checksum mismatch (expected %u)"
 			 " at offset %" PRIu64,
-			 fio_filename(fileno(f)), (unsigned) crc32c,
-			 (uint64_t) ftello(f));
+			 i->log->filename, (unsigned) crc32c,
+			 (uint64_t) xlog_cursor_offset(i));
 		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
 	}
 
-	data = bodybuf;
-	xrow_header_decode(row, &data, bodybuf + len);
+	i->rpos = data + len;
+	xrow_header_decode(row, &data, data + len);
 
 	return 0;
 }
 
+/**
+ * Read and uncompress a block of rows. A block has the same
+ * fixed header as a row, but the previous row crc32 slot holds
+ * the uncompressed size of the block.
+ *
+ * @retval 0 success
+ * @retval 1 EOF
+ */
+static int
+block_reader(struct xlog_cursor *i)
+{
+	uint32_t len, size, crc32c;
+
+	if (xlog_cursor_fill(i, XLOG_FIXHEADER_SIZE) != 0)
+		return 1;
+	if (xlog_decode_fixheader(i->rpos + sizeof(log_magic_t),
+				  XLOG_FIXHEADER_SIZE - sizeof(log_magic_t),
+				  &len, &size, &crc32c) != 0 ||
+	    len > IPROTO_BODY_LEN_MAX || size > IPROTO_BODY_LEN_MAX) {
+error:
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: failed to read or parse block"
+			 " at offset %" PRIu64, i->log->filename,
+			 (uint64_t) xlog_cursor_offset(i));
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
+	}
+
+	if (xlog_cursor_fill(i, XLOG_FIXHEADER_SIZE + len) != 0)
+		return 1;
+	const char *zbuf = i->rpos + XLOG_FIXHEADER_SIZE;
+
+	if (crc32_calc(0, zbuf, len) != crc32c) {
+		char buf[PATH_MAX];
+
+		snprintf(buf, sizeof(buf), "%s: block checksum mismatch (expected %u)"
+			 " at offset %" PRIu64,
+			 i->log->filename, (unsigned) crc32c,
+			 (uint64_t) xlog_cursor_offset(i));
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
+	}
+
+	if (size > i->block_capacity) {
+		char *block = (char *) realloc(i->block, size);
+		if (block == NULL)
+			tnt_raise(OutOfMemory, size, "malloc", "xlog block");
+		i->block = block;
+		i->block_capacity = size;
+	}
+	uLongf block_size = size;
+	if (uncompress((Bytef *) i->block, &block_size,
+		       (const Bytef *) zbuf, len) != Z_OK ||
+	    block_size != size)
+		goto error;
+
+	i->rpos = zbuf + len;
+	i->block_pos = i->block;
+	i->block_end = i->block + size;
+	return 0;
+}
+
+/**
+ * Read the next row of the current block.
+ */
+static void
+block_row_reader(struct xlog_cursor *i, struct xrow_header *row)
+{
+	const char *data = i->block_pos;
+	uint32_t len, crc32p, crc32c;
+	log_magic_t magic;
+
+	if (i->block_end - data < XLOG_FIXHEADER_SIZE)
+		goto error;
+	memcpy(&magic, data, sizeof(magic));
+	if (magic != row_marker ||
+	    xlog_decode_fixheader(data + sizeof(magic),
+				  XLOG_FIXHEADER_SIZE - sizeof(magic),
+				  &len, &crc32p, &crc32c) != 0 ||
+	    len > i->block_end - data - XLOG_FIXHEADER_SIZE) {
+error:
+		char buf[PATH_MAX];
+		snprintf(buf, sizeof(buf), "%s: failed to read or parse row header"
+			 " in block before offset %" PRIu64,
+			 i->log->filename, (uint64_t) i->good_offset);
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
+	}
+	(void) crc32p;
+	data += XLOG_FIXHEADER_SIZE;
+
+	if (crc32_calc(0, data, len) != crc32c) {
+		char buf[PATH_MAX];
+
+		snprintf(buf, sizeof(buf), "%s: row checksum mismatch (expected %u)"
+			 " in block before offset %" PRIu64,
+			 i->log->filename, (unsigned) crc32c,
+			 (uint64_t) i->good_offset);
+		tnt_raise(ClientError, ER_INVALID_MSGPACK, buf);
+	}
+	i->block_pos = data + len;
+	xrow_header_decode(row, &data, data + len);
+}
+
+static void
+xlog_encode_fixheader(char *fixheader, log_magic_t magic, uint32_t len,
+		      uint32_t crc32p, uint32_t crc32c)
+{
+	char *data = fixheader;
+	*(log_magic_t *) data = magic;
+	data += sizeof(magic);
+	data = mp_encode_uint(data, len);
+	/* Encode crc32 for previous row */
+	data = mp_encode_uint(data, crc32p);
+	/* Encode crc32 for current row */
+	data = mp_encode_uint(data, crc32c);
+	/* Encode padding */
+	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
+	if (padding > 0)
+		data = mp_encode_strl(data, padding - 1) + padding - 1;
+	assert(data == fixheader + XLOG_FIXHEADER_SIZE);
+}
+
 int
 xlog_encode_row(const struct xrow_header *row, struct iovec *iov)
 {
@@ -445,19 +661,7 @@ xlog_encode_row(const struct xrow_header *row, struct iovec *iov)
 		len += iov[i].iov_len;
 	}
 
-	char *data = fixheader;
-	*(log_magic_t *) data = row_marker;
-	data += sizeof(row_marker);
-	data = mp_encode_uint(data, len);
-	/* Encode crc32 for previous row */
-	data = mp_encode_uint(data, crc32p);
-	/* Encode crc32 for current row */
-	data = mp_encode_uint(data, crc32c);
-	/* Encode padding */
-	ssize_t padding = XLOG_FIXHEADER_SIZE - (data - fixheader);
-	if (padding > 0)
-		data = mp_encode_strl(data, padding - 1) + padding - 1;
-	assert(data == fixheader + XLOG_FIXHEADER_SIZE);
+	xlog_encode_fixheader(fixheader, row_marker, len, crc32p, crc32c);
 	iov[0].iov_base = fixheader;
 	iov[0].iov_len = XLOG_FIXHEADER_SIZE;
 
@@ -465,6 +669,63 @@ xlog_encode_row(const struct xrow_header *row, struct iovec *iov)
 	return iovcnt;
 }
 
+void
+xlog_block_create(struct xlog_block *block)
+{
+	memset(block, 0, sizeof(*block));
+}
+
+void
+xlog_block_destroy(struct xlog_block *block)
+{
+	free(block->data);
+}
+
+void
+xlog_block_add(struct xlog_block *block, const struct iovec *iov,
+	       int iovcnt)
+{
+	size_t len = 0;
+	for (int i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+	if (block->size + len > block->capacity) {
+		size_t capacity = MAX(block->capacity, XLOG_BLOCK_SIZE);
+		while (capacity < block->size + len)
+			capacity *= 2;
+		char *data = (char *) realloc(block->data, capacity);
+		if (data == NULL) {
+			tnt_raise(OutOfMemory, capacity, "malloc",
+				  "struct xlog_block");
+		}
+		block->data = data;
+		block->capacity = capacity;
+	}
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(block->data + block->size, iov[i].iov_base,
+		       iov[i].iov_len);
+		block->size += iov[i].iov_len;
+	}
+}
+
+int
+xlog_encode_block(struct xlog_block *block, struct iovec *iov)
+{
+	uLongf len = compressBound(block->size);
+	char *fixheader = (char *) region_alloc(&fiber()->gc,
+						XLOG_FIXHEADER_SIZE + len);
+	char *data = fixheader + XLOG_FIXHEADER_SIZE;
+	if (compress2((Bytef *) data, &len, (const Bytef *) block->data,
+		      block->size, Z_BEST_SPEED) != Z_OK) {
+		tnt_raise(OutOfMemory, len, "zlib", "xlog block");
+	}
+	xlog_encode_fixheader(fixheader, block_marker, len, block->size,
+			      crc32_calc(0, data, len));
+	iov[0].iov_base = fixheader;
+	iov[0].iov_len = XLOG_FIXHEADER_SIZE + len;
+	block->size = 0;
+	return 1;
+}
+
 void
 xlog_cursor_open(struct xlog_cursor *i, struct xlog *l)
 {
@@ -472,6 +733,13 @@ xlog_cursor_open(struct xlog_cursor *i, struct xlog *l)
 	i->row_count = 0;
 	i->good_offset = ftello(l->f);
 	i->eof_read  = false;
+	i->rbuf = NULL;
+	i->rbuf_capacity = 0;
+	i->rpos = i->rend = NULL;
+	i->rend_offset = i->good_offset;
+	i->block = NULL;
+	i->block_capacity = 0;
+	i->block_pos = i->block_end = NULL;
 }
 
 void
@@ -486,6 +754,8 @@ xlog_cursor_close(struct xlog_cursor *i)
 	 * Seek back to last known good offset.
 	 */
 	fseeko(l->f, i->good_offset, SEEK_SET);
+	free(i->rbuf);
+	free(i->block);
 	region_free(&fiber()->gc);
 }
 
@@ -503,7 +773,7 @@ xlog_cursor_next(struct xlog_cursor *i, struct xrow_header *row)
 {
 	struct xlog *l = i->log;
 	log_magic_t magic;
-	off_t marker_offset = 0;
+	off_t marker_offset;
 
 	assert(i->eof_read == false);
 
@@ -517,23 +787,30 @@ xlog_cursor_next(struct xlog_cursor *i, struct xrow_header *row)
 	 */
 	region_free_after(&fiber()->gc, 128 * 1024);
 
+	if (i->block_pos < i->block_end) {
+		try {
+			block_row_reader(i, row);
+			goto done;
+		} catch (ClientError *e) {
+			if (l->dir->panic_if_error)
+				throw;
+			/* Skip the rest of the block. */
+			say_warn("failed to read row");
+			i->block_pos = i->block_end;
+		}
+	}
 restart:
-	if (marker_offset > 0)
-		fseeko(l->f, marker_offset + 1, SEEK_SET);
-
-	if (fread(&magic, sizeof(magic), 1, l->f) != 1)
-		goto eof;
-
-	while (magic != row_marker) {
-		int c = fgetc(l->f);
-		if (c == EOF) {
+	for (;;) {
+		if (xlog_cursor_fill(i, sizeof(magic)) != 0) {
 			say_debug("eof while looking for magic");
 			goto eof;
 		}
-		magic = magic >> 8 |
-			((log_magic_t) c & 0xff) << (sizeof(magic)*8 - 8);
+		memcpy(&magic, i->rpos, sizeof(magic));
+		if (magic == row_marker || magic == block_marker)
+			break;
+		i->rpos++;
 	}
-	marker_offset = ftello(l->f) - sizeof(row_marker);
+	marker_offset = xlog_cursor_offset(i);
 	if (i->good_offset != marker_offset)
 		say_warn("skipped %jd bytes after 0x%08jx offset",
 			(intmax_t)(marker_offset - i->good_offset),
@@ -541,8 +818,15 @@ restart:
 	say_debug("magic found at 0x%08jx", (uintmax_t)marker_offset);
 
 	try {
-		if (row_reader(l->f, row) != 0)
-			goto eof;
+		if (magic == row_marker) {
+			if (row_reader(i, row) != 0)
+				goto eof;
+		} else {
+			if (block_reader(i) != 0)
+				goto eof;
+			i->good_offset = xlog_cursor_offset(i);
+			block_row_reader(i, row);
+		}
 	} catch (ClientError *e) {
 		if (l->dir->panic_if_error)
 			throw;
@@ -554,10 +838,18 @@ restart:
 		 * written WAL.
 		 */
 		say_warn("failed to read row");
+		i->block_pos = i->block_end;
+		/*
+		 * Look for the next marker after this one,
+		 * unless the row or block has been consumed.
+		 */
+		if (xlog_cursor_offset(i) == marker_offset)
+			i->rpos++;
 		goto restart;
 	}
 
-	i->good_offset = ftello(l->f);
+	i->good_offset = xlog_cursor_offset(i);
+done:
 	i->row_count++;
 
 	if (i->row_count % 100000 == 0)
@@ -578,7 +870,7 @@ eof:
 		} else if (magic == eof_marker) {
 			i->good_offset = ftello(l->f);
 			i->eof_read = true;
-		} else if (magic != row_marker) {
+		} else if (magic != row_marker && magic != block_marker) {
 			say_error("eof marker is corrupt: %lu",
 				  (unsigned long) magic);
 		} else {
@@ -734,7 +1026,8 @@ static int
 xlog_write_meta(struct xlog *l)
 {
 	char *vstr = NULL;
-	if (fprintf(l->f, "%s%s", l->dir->filetype, v12) < 0 ||
+	const char *version = l->dir->compress ? v13 : v12;
+	if (fprintf(l->f, "%s%s", l->dir->filetype, version) < 0 ||
 	    fprintf(l->f, SERVER_UUID_KEY ": %s\n",
 		    tt_uuid_str(l->dir->server_uuid)) < 0 ||
 	    (vstr = vclock_to_string(&l->vclock)) == NULL ||
@@ -770,7 +1063,7 @@ xlog_read_meta(struct xlog *l, int64_t signature)
 		tnt_raise(XlogError, "%s: unknown filetype", l->filename);
 	}
 
-	if (strcmp(v12, version) != 0) {
+	if (strcmp(v12, version) != 0 && strcmp(v13, version) != 0) {
 		tnt_raise(XlogError, "%s: unsupported file format version",
 			  l->filename);
 	}
@@ -861,6 +1154,12 @@ xlog_open_stream(struct xdir *dir, int64_t signature, enum log_suffix suffix,
 
 	xlog_read_meta(l, signature);
 
+#if defined(HAVE_POSIX_FADVISE)
+	/* Logs are read sequentially, ask for aggressive readahead. */
+	if (fileno(file) >= 0)
+		posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
 	log_guard.is_active = false;
 	return l;
 }
@@ -75,6 +75,13 @@ struct xdir {
 	 * speed up sync of write ahead logs, but not snapshots).
 	 */
 	bool sync_is_async;
+	/**
+	 * true if rows of files created in this directory
+	 * are written in compressed blocks, see
+	 * xlog_encode_block(). Files of both formats
+	 * are readable regardless of this flag.
+	 */
+	bool compress;
 
 	/**
 	 * Additional flags to apply at fopen(2) to write.
@@ -281,12 +288,36 @@ xlog_atfork(struct xlog **lptr);
 
 /* {{{ xlog_cursor - read rows from a log file */
 
+enum {
+	/** The size of a read-ahead chunk of a log file. */
+	XLOG_READ_AHEAD = 4 * 1024 * 1024,
+	/** The read-ahead chunk of a file with little data left. */
+	XLOG_READ_AHEAD_MIN = 64 * 1024,
+};
+
 struct xlog_cursor
 {
 	struct xlog *log;
 	int row_count;
 	off_t good_offset;
 	bool eof_read;
+	/**
+	 * Read-ahead buffer. Rows are decoded in place and
+	 * stay valid until the next xlog_cursor_next().
+	 */
+	char *rbuf;
+	size_t rbuf_capacity;
+	/** Unread data in the read-ahead buffer. */
+	const char *rpos;
+	const char *rend;
+	/** File offset of rend. */
+	off_t rend_offset;
+	/** Uncompressed contents of the current block, if any. */
+	char *block;
+	size_t block_capacity;
+	/** Unread rows of the current block. */
+	const char *block_pos;
+	const char *block_end;
 };
 
 void
@@ -321,6 +352,46 @@ inprogress_log_unlink(char *filename);
 int
 xlog_encode_row(const struct xrow_header *packet, struct iovec *iov);
 
+/**
+ * The size of uncompressed rows after which a block
+ * of a compressed log file is written out.
+ */
+enum { XLOG_BLOCK_SIZE = 256 * 1024 };
+
+/**
+ * Rows accumulated for a block of a compressed log file.
+ */
+struct xlog_block {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+void
+xlog_block_create(struct xlog_block *block);
+
+void
+xlog_block_destroy(struct xlog_block *block);
+
+/**
+ * Append a row encoded with xlog_encode_row() to the block.
+ * Throws an exception in case of error.
+ */
+void
+xlog_block_add(struct xlog_block *block, const struct iovec *iov,
+	       int iovcnt);
+
+/**
+ * Compress rows of the block and construct a block to write
+ * to the log file. The block is emptied. The result is
+ * allocated on the fiber region.
+ * Throws an exception in case of error.
+ *
+ * @return the number of iovecs used.
+ */
+int
+xlog_encode_block(struct xlog_block *block, struct iovec *iov);
+
 /** }}} */
 
 #endif /* TARANTOOL_XLOG_H_INCLUDED */
@@ -0,0 +1,94 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "cpipe.h"
+#include "fiber.h"
+#include "tt_pthread.h"
+
+/**
+ * Invoked in the consumer cord: fetch all published
+ * messages and deliver them.
+ */
+static void
+cpipe_fetch_output_cb(ev_loop * /* loop */, struct ev_async *watcher,
+		      int /* events */)
+{
+	struct cpipe *pipe = (struct cpipe *) watcher->data;
+	struct cmsg_fifo output = STAILQ_HEAD_INITIALIZER(output);
+
+	(void) tt_pthread_mutex_lock(&pipe->mutex);
+	STAILQ_CONCAT(&output, &pipe->pipe);
+	(void) tt_pthread_mutex_unlock(&pipe->mutex);
+
+	/*
+	 * Can't use STAILQ_FOREACH since the callback
+	 * may free the message or push it into another pipe.
+	 */
+	struct cmsg *msg, *tmp;
+	STAILQ_FOREACH_SAFE(msg, &output, fifo, tmp)
+		msg->f(msg);
+}
+
+void
+cpipe_create(struct cpipe *pipe)
+{
+	STAILQ_INIT(&pipe->output);
+	STAILQ_INIT(&pipe->pipe);
+	(void) tt_pthread_mutex_init(&pipe->mutex, NULL);
+	pipe->consumer = loop();
+	ev_async_init(&pipe->fetch_output, cpipe_fetch_output_cb);
+	pipe->fetch_output.data = pipe;
+	ev_async_start(pipe->consumer, &pipe->fetch_output);
+}
+
+void
+cpipe_destroy(struct cpipe *pipe)
+{
+	assert(loop() == pipe->consumer);
+	ev_async_stop(pipe->consumer, &pipe->fetch_output);
+	(void) tt_pthread_mutex_destroy(&pipe->mutex);
+}
+
+void
+cpipe_flush(struct cpipe *pipe)
+{
+	if (STAILQ_EMPTY(&pipe->output))
+		return;
+
+	(void) tt_pthread_mutex_lock(&pipe->mutex);
+	bool pipe_was_empty = STAILQ_EMPTY(&pipe->pipe);
+	STAILQ_CONCAT(&pipe->pipe, &pipe->output);
+	(void) tt_pthread_mutex_unlock(&pipe->mutex);
+	/*
+	 * If the pipe was not empty, the consumer has
+	 * already been signalled and has not fetched the
+	 * messages yet.
+	 */
+	if (pipe_was_empty)
+		ev_async_send(pipe->consumer, &pipe->fetch_output);
+}
@@ -0,0 +1,117 @@
+#ifndef TARANTOOL_CPIPE_H_INCLUDED
+#define TARANTOOL_CPIPE_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <pthread.h>
+#include "third_party/tarantool_ev.h"
+#include "third_party/queue.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * @brief CORD PIPES
+ *
+ * A one-way channel to pass messages from one cord (thread)
+ * to another. The producer stages messages locally with
+ * cpipe_push() and publishes a whole batch with cpipe_flush(),
+ * taking the pipe mutex once per batch. The consumer is woken
+ * up with ev_async and invokes each message callback in its own
+ * event loop, in FIFO order.
+ *
+ * A message is owned by the cord which is processing it. Memory
+ * of a message is usually allocated from a cord-local allocator,
+ * so a message should be sent back to its origin to be freed.
+ * Reset the callback with cmsg_init() before passing a message
+ * on, since it is invoked by whichever cord receives it.
+ */
+
+struct cmsg;
+
+/** A message callback, invoked in the consumer cord. */
+typedef void (*cmsg_f)(struct cmsg *);
+
+/** A message passed between cords. Embed into a message body. */
+struct cmsg {
+	STAILQ_ENTRY(cmsg) fifo;
+	/** Invoked in the consumer cord upon delivery. */
+	cmsg_f f;
+};
+
+STAILQ_HEAD(cmsg_fifo, cmsg);
+
+static inline void
+cmsg_init(struct cmsg *msg, cmsg_f f)
+{
+	msg->f = f;
+}
+
+struct cpipe {
+	/** Staged messages, accessed by the producer only. */
+	struct cmsg_fifo output;
+	/** Published messages, protected by the mutex. */
+	struct cmsg_fifo pipe;
+	pthread_mutex_t mutex;
+	/** Event loop of the consumer cord. */
+	struct ev_loop *consumer;
+	/** Wakes up the consumer when the pipe becomes non-empty. */
+	struct ev_async fetch_output;
+};
+
+/**
+ * Initialize a pipe. Must be called in the consumer cord: the
+ * pipe delivers messages to the event loop of the caller.
+ */
+void
+cpipe_create(struct cpipe *pipe);
+
+/** Destroy a pipe. Must be called in the consumer cord. */
+void
+cpipe_destroy(struct cpipe *pipe);
+
+/**
+ * Stage a message for sending. The message is not visible to
+ * the consumer until cpipe_flush() is called.
+ */
+static inline void
+cpipe_push(struct cpipe *pipe, struct cmsg *msg)
+{
+	STAILQ_INSERT_TAIL(&pipe->output, msg, fifo);
+}
+
+/** Publish all staged messages and wake up the consumer. */
+void
+cpipe_flush(struct cpipe *pipe);
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_CPIPE_H_INCLUDED */
@@ -36,6 +36,7 @@ void *ffi_symbols[] = {
 	(void *) boxffi_index_memsize,
 	(void *) boxffi_index_random,
 	(void *) boxffi_index_get,
+	(void *) boxffi_index_get_many,
 	(void *) boxffi_index_iterator,
 	(void *) boxffi_tuple_update,
 	(void *) boxffi_iterator_next,
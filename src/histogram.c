@@ -0,0 +1,66 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include "histogram.h"
+#include <string.h>
+
+/** The largest value which falls into the bucket. */
+static int64_t
+histogram_bucket_upper(int idx)
+{
+	if (idx < HISTOGRAM_SUB_BUCKETS)
+		return idx;
+	int shift = idx / HISTOGRAM_SUB_BUCKETS - 1;
+	int64_t sub = HISTOGRAM_SUB_BUCKETS + idx % HISTOGRAM_SUB_BUCKETS;
+	return ((sub + 1) << shift) - 1;
+}
+
+int64_t
+histogram_percentile(const struct histogram *h, double percent)
+{
+	if (h->count == 0)
+		return 0;
+	int64_t rank = (int64_t) (h->count * percent / 100);
+	if (rank >= h->count)
+		rank = h->count - 1;
+	int64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen > rank) {
+			int64_t upper = histogram_bucket_upper(i);
+			return upper < h->max ? upper : h->max;
+		}
+	}
+	return h->max;
+}
+
+void
+histogram_reset(struct histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+}
@@ -0,0 +1,118 @@
+#ifndef TARANTOOL_HISTOGRAM_H_INCLUDED
+#define TARANTOOL_HISTOGRAM_H_INCLUDED
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * A log-linear latency histogram.
+ *
+ * Values below HISTOGRAM_SUB_BUCKETS have a bucket each, every
+ * following power of two is split into HISTOGRAM_SUB_BUCKETS
+ * equal buckets, so the relative error of a reported percentile
+ * is bounded by 1/HISTOGRAM_SUB_BUCKETS (6%). Values are in
+ * nanoseconds, anything above 2^HISTOGRAM_MAX_BITS (~68 seconds)
+ * lands in the last bucket.
+ *
+ * Recording a value is a couple of arithmetic instructions
+ * and an increment, there is no locking: a histogram must be
+ * updated from a single thread.
+ */
+enum {
+	HISTOGRAM_SUB_BITS = 4,
+	HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS,
+	HISTOGRAM_MAX_BITS = 36,
+	HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) *
+		HISTOGRAM_SUB_BUCKETS
+};
+
+struct histogram {
+	/** Number of collected values. */
+	int64_t count;
+	/** Sum of collected values, for the average. */
+	int64_t sum;
+	/** The largest collected value. */
+	int64_t max;
+	int64_t buckets[HISTOGRAM_BUCKETS];
+};
+
+static inline int
+histogram_bucket(int64_t value)
+{
+	if (value < HISTOGRAM_SUB_BUCKETS)
+		return value < 0 ? 0 : (int) value;
+	if (value >= (1LL << HISTOGRAM_MAX_BITS))
+		return HISTOGRAM_BUCKETS - 1;
+	int msb = 63 - __builtin_clzll((unsigned long long) value);
+	int shift = msb - HISTOGRAM_SUB_BITS;
+	return shift * HISTOGRAM_SUB_BUCKETS + (int) (value >> shift);
+}
+
+/** Account a value (nanoseconds) in the histogram. */
+static inline void
+histogram_collect(struct histogram *h, int64_t value)
+{
+	h->buckets[histogram_bucket(value)]++;
+	h->count++;
+	h->sum += value;
+	if (value > h->max)
+		h->max = value;
+}
+
+/**
+ * Return the value below which the given percent (0..100)
+ * of the collected values fall. The value is the upper bound
+ * of the matching bucket, but never exceeds the maximum.
+ */
+int64_t
+histogram_percentile(const struct histogram *h, double percent);
+
+void
+histogram_reset(struct histogram *h);
+
+/** Monotonic time in nanoseconds, for latency measurement. */
+static inline int64_t
+clock_monotonic64(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_HISTOGRAM_H_INCLUDED */
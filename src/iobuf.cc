@@ -93,32 +93,43 @@ ibuf_reserve(struct ibuf *ibuf, size_t size)
 /* {{{ struct obuf */
 
 /**
- * Initialize the next slot in iovec array. The buffer
- * always has at least one empty slot.
+ * Make sure the iovec array has room for at least
+ * \a count vectors. The old array is left intact: the network
+ * cord may be reading it through a savepoint, see iproto_flush().
  */
 static inline void
-obuf_init_pos(struct obuf *buf, size_t pos)
+obuf_reserve_iov(struct obuf *buf, size_t count)
 {
-	if (pos >= IOBUF_IOV_MAX) {
-		tnt_raise(OutOfMemory, buf->pos, "obuf_init_pos", "iovec");
-	}
-	buf->iov[pos].iov_base = NULL;
-	buf->iov[pos].iov_len = 0;
-	buf->capacity[pos] = 0;
+	if (count <= buf->iov_capacity)
+		return;
+	size_t capacity = buf->iov_capacity * 2;
+	while (capacity < count)
+		capacity *= 2;
+	struct iovec *iov = (struct iovec *)
+		region_alloc(buf->pool, capacity * sizeof(*iov));
+	memcpy(iov, buf->iov, (buf->pos + 1) * sizeof(*iov));
+	buf->iov = iov;
+	buf->iov_capacity = capacity;
 }
 
-/** Allocate memory for a single iovec buffer. */
+/**
+ * Allocate memory for a chunk, at least \a size bytes,
+ * and at least twice as big as the previous chunk.
+ */
 static inline void
-obuf_alloc_pos(struct obuf *buf, size_t pos, size_t size)
+obuf_alloc_chunk(struct obuf *buf, size_t chunk_pos, size_t size)
 {
-	size_t capacity = pos > 0 ?  buf->capacity[pos-1] * 2 : buf->alloc_factor;
+	if (chunk_pos >= OBUF_CHUNK_MAX) {
+		tnt_raise(OutOfMemory, buf->size, "obuf_alloc_chunk",
+			  "chunk");
+	}
+	size_t capacity = chunk_pos > 0 ?
+		buf->capacity[chunk_pos - 1] * 2 : buf->alloc_factor;
 	while (capacity < size) {
 		capacity *=2;
 	}
-
-	buf->iov[pos].iov_base = region_alloc(buf->pool, capacity);
-	buf->capacity[buf->pos] = capacity;
-	assert(buf->iov[pos].iov_len == 0);
+	buf->chunk[chunk_pos] = (char *) region_alloc(buf->pool, capacity);
+	buf->capacity[chunk_pos] = capacity;
 }
 
 /** Initialize an output buffer instance. Don't allocate memory
@@ -131,100 +142,127 @@ obuf_create(struct obuf *buf, struct region *pool, size_t alloc_factor)
 	buf->pos = 0;
 	buf->size = 0;
 	buf->alloc_factor = alloc_factor;
-	obuf_init_pos(buf, buf->pos);
+	buf->chunk_pos = 0;
+	buf->chunk_used = 0;
+	memset(buf->chunk, 0, sizeof(buf->chunk));
+	memset(buf->capacity, 0, sizeof(buf->capacity));
+	buf->iov = buf->iov_buf;
+	buf->iov_capacity = OBUF_IOV_MIN;
+	buf->iov[0].iov_base = NULL;
+	buf->iov[0].iov_len = 0;
+	buf->refs = NULL;
+	buf->ref_count = 0;
+	buf->ref_capacity = 0;
+	buf->ref_released = 0;
 }
 
-/** Mark an output buffer as empty. */
-static void
+/**
+ * Mark an output buffer as empty. References, if any,
+ * are kept: they are released by their owner.
+ */
+void
 obuf_reset(struct obuf *buf)
 {
 	buf->pos = 0;
 	buf->size = 0;
-	for (struct iovec *iov = buf->iov; iov->iov_len != 0; iov++) {
-		assert(iov < buf->iov + IOBUF_IOV_MAX);
-		iov->iov_len = 0;
-	}
+	buf->chunk_pos = 0;
+	buf->chunk_used = 0;
+	buf->iov[0].iov_base = buf->chunk[0];
+	buf->iov[0].iov_len = 0;
 }
 
 /** Add data to the output buffer. Copies the data. */
 void
 obuf_dup(struct obuf *buf, const void *data, size_t size)
 {
-	struct iovec *iov = &buf->iov[buf->pos];
-	size_t capacity = buf->capacity[buf->pos];
-	/**
-	 * @pre buf->pos points at an array of allocated buffers.
-	 * The array ends with a zero-initialized buffer.
-	 */
-	while (iov->iov_len + size > capacity) {
+	while (buf->chunk_used + size > buf->capacity[buf->chunk_pos]) {
 		/*
-		 * The data doesn't fit into this buffer.
-		 * It could be because the buffer is not
-		 * allocated, is partially or completely full.
-		 * Copy as much as possible into already
-		 * allocated buffers.
+		 * The data doesn't fit into this chunk.
+		 * Copy as much as possible and continue
+		 * in the next one.
 		 */
-		if (iov->iov_len < capacity) {
-			/*
-			 * This buffer is allocated, but can't
-			 * fit all the data. Copy as much data as
-			 * possible.
-			 */
-			size_t fill = capacity - iov->iov_len;
+		size_t fill = buf->capacity[buf->chunk_pos] -
+			buf->chunk_used;
+		if (fill > 0) {
 			assert(fill < size);
-			memcpy((char *) iov->iov_base + iov->iov_len, data, fill);
-
-			iov->iov_len += fill;
-			buf->size += fill;
+			memcpy(buf->chunk[buf->chunk_pos] + buf->chunk_used,
+			       data, fill);
+			obuf_advance(buf, fill);
 			data = (char *) data + fill;
 			size -= fill;
-			/*
-			 * Check if the remainder can fit
-			 * without allocations.
-			 */
-		} else if (capacity == 0) {
-			/**
-			 * Still some data to copy. We have to get
-			 * a new buffer. Before we allocate
-			 * a buffer for this position, ensure
-			 * there is an unallocated buffer in the
-			 * next one, since it works as an end
-			 * marker for the loop above.
-			 */
-			obuf_init_pos(buf, buf->pos + 1);
-			obuf_alloc_pos(buf, buf->pos, size);
-			break;
 		}
-		assert(capacity == iov->iov_len);
-		buf->pos++;
-		iov = &buf->iov[buf->pos];
-		capacity = buf->capacity[buf->pos];
+		obuf_ensure_resize(buf, size);
 	}
-	memcpy((char *) iov->iov_base + iov->iov_len, data, size);
-	iov->iov_len += size;
-	buf->size += size;
-	assert(iov->iov_len <= buf->capacity[buf->pos]);
+	memcpy(buf->chunk[buf->chunk_pos] + buf->chunk_used, data, size);
+	obuf_advance(buf, size);
 }
 
 void
 obuf_ensure_resize(struct obuf *buf, size_t size)
 {
 	struct iovec *iov = &buf->iov[buf->pos];
-	size_t capacity = buf->capacity[buf->pos];
+	if (buf->chunk_used > 0) {
+		/* Move to the next chunk. */
+		size_t chunk_pos = buf->chunk_pos + 1;
+		if (chunk_pos >= OBUF_CHUNK_MAX ||
+		    buf->capacity[chunk_pos] < size)
+			obuf_alloc_chunk(buf, chunk_pos, size);
+		buf->chunk_pos = chunk_pos;
+		buf->chunk_used = 0;
+	} else {
+		/* The current chunk is empty, but too small. */
+		obuf_alloc_chunk(buf, buf->chunk_pos, size);
+	}
 	if (iov->iov_len > 0) {
-		/* Move to the next buffer. */
-		buf->pos++;
-		iov = &buf->iov[buf->pos];
-		capacity = buf->capacity[buf->pos];
+		/* Data in different chunks needs different vectors. */
+		obuf_reserve_iov(buf, buf->pos + 2);
+		iov = &buf->iov[++buf->pos];
+		iov->iov_len = 0;
 	}
-	/* Make sure the next buffer can store size.  */
-	if (capacity == 0) {
-		obuf_init_pos(buf, buf->pos + 1);
-		obuf_alloc_pos(buf, buf->pos, size);
-	} else if (size > capacity) {
-		/* Simply realloc. */
-		obuf_alloc_pos(buf, buf->pos, size);
+	iov->iov_base = buf->chunk[buf->chunk_pos];
+}
+
+void
+obuf_add_ref(struct obuf *buf, const void *data, size_t size, void *ref)
+{
+	/* Allocate everything first to not leave a stray reference. */
+	if (buf->ref_count == buf->ref_capacity) {
+		size_t capacity = MAX(buf->ref_capacity * 2, 64);
+		void **refs = (void **)
+			region_alloc(buf->pool, capacity * sizeof(*refs));
+		memcpy(refs, buf->refs, buf->ref_count * sizeof(*refs));
+		buf->refs = refs;
+		buf->ref_capacity = capacity;
 	}
+	obuf_reserve_iov(buf, buf->pos + 3);
+
+	struct iovec *iov = &buf->iov[buf->pos];
+	if (iov->iov_len > 0)
+		iov = &buf->iov[++buf->pos];
+	iov->iov_base = (void *) data;
+	iov->iov_len = size;
+	buf->size += size;
+	/* Copied data continues in a new vector. */
+	iov = &buf->iov[++buf->pos];
+	iov->iov_base = buf->chunk[buf->chunk_pos] + buf->chunk_used;
+	iov->iov_len = 0;
+	buf->refs[buf->ref_count++] = ref;
+}
+
+void
+obuf_release_refs(struct obuf *buf, struct obuf_svp *svp,
+		  void (*unref)(void *))
+{
+	if (svp->refs <= buf->ref_released)
+		return;
+	size_t count = svp->refs - buf->ref_released;
+	assert(count <= buf->ref_count);
+	for (size_t i = 0; i < count; i++)
+		unref(buf->refs[i]);
+	buf->ref_count -= count;
+	memmove(buf->refs, buf->refs + count,
+		buf->ref_count * sizeof(*buf->refs));
+	buf->ref_released = svp->refs;
 }
 
 /** Book a few bytes in the output buffer. */
@@ -233,34 +271,29 @@ obuf_book(struct obuf *buf, size_t size)
 {
 	obuf_ensure(buf, size);
 
-	struct obuf_svp svp;
-	svp.pos = buf->pos;
-	svp.iov_len = buf->iov[buf->pos].iov_len;
-	svp.size = buf->size;
+	struct obuf_svp svp = obuf_create_svp(buf);
 
 	obuf_advance(buf, size);
 	return svp;
 }
 
-/** Forget about data in the output buffer beyond the savepoint. */
+/**
+ * Forget about data in the output buffer beyond the savepoint.
+ * References added after the savepoint are kept until
+ * obuf_release_refs().
+ */
 void
 obuf_rollback_to_svp(struct obuf *buf, struct obuf_svp *svp)
 {
-	bool is_last_pos = buf->pos == svp->pos;
-
 	buf->pos = svp->pos;
-	buf->iov[buf->pos].iov_len = svp->iov_len;
 	buf->size = svp->size;
-	/**
-	 * We need this check to ensure the following
-	 * loop doesn't run away.
-	 */
-	if (is_last_pos)
-		return;
-	for (struct iovec *iov = buf->iov + buf->pos + 1; iov->iov_len != 0; iov++) {
-		assert(iov < buf->iov + IOBUF_IOV_MAX);
-		iov->iov_len = 0;
-	}
+	buf->chunk_pos = svp->chunk_pos;
+	buf->chunk_used = svp->chunk_used;
+	/* The vector may have been taken by a reference. */
+	struct iovec *iov = &buf->iov[buf->pos];
+	iov->iov_base = buf->chunk[buf->chunk_pos] + buf->chunk_used -
+		svp->iov_len;
+	iov->iov_len = svp->iov_len;
 }
 
 /* struct obuf }}} */
@@ -318,6 +351,37 @@ iobuf_delete(struct iobuf *iobuf)
 	SLIST_INSERT_HEAD(&iobuf_cache, iobuf, next);
 }
 
+struct iobuf *
+iobuf_new_mt(const char *name, struct slab_cache *slabc_out)
+{
+	struct iobuf *iobuf = (struct iobuf *) mempool_alloc(&iobuf_pool);
+	region_create(&iobuf->pool, &cord()->slabc);
+	region_create(&iobuf->out_pool, slabc_out);
+	region_set_name(&iobuf->pool, name);
+	region_set_name(&iobuf->out_pool, name);
+	/* Note: do not allocate memory upfront. */
+	ibuf_create(&iobuf->in, &iobuf->pool);
+	obuf_create(&iobuf->out, &iobuf->out_pool, iobuf_readahead);
+	return iobuf;
+}
+
+void
+iobuf_delete_out(struct iobuf *iobuf)
+{
+	assert(iobuf->out.ref_count == 0);
+	region_free(&iobuf->out_pool);
+	obuf_create(&iobuf->out, &iobuf->out_pool, iobuf_readahead);
+}
+
+void
+iobuf_delete_mt(struct iobuf *iobuf)
+{
+	/* The output must have been released by its cord. */
+	assert(region_used(&iobuf->out_pool) == 0);
+	region_free(&iobuf->pool);
+	mempool_free(&iobuf_pool, iobuf);
+}
+
 /** Send all data in the output buffer and garbage collect. */
 ssize_t
 iobuf_flush(struct iobuf *iobuf, struct ev_io *coio)
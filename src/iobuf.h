@@ -95,16 +95,26 @@ ibuf_pos(struct ibuf *ibuf)
 
 /* {{{ Output buffer. */
 
-enum { IOBUF_IOV_MAX = 32 };
+enum {
+	/** Max number of memory chunks of an output buffer. */
+	OBUF_CHUNK_MAX = 32,
+	/** The size of the iovec array embedded into struct obuf. */
+	OBUF_IOV_MIN = 16
+};
 
 /**
  * An output buffer is an array of struct iovec vectors
  * for writev().
- * Each buffer is allocated on region allocator.
- * Buffer size grows by a factor of 2. With this growth factor,
- * the number of used buffers is unlikely to ever exceed the
- * hard limit of IOBUF_IOV_MAX. If it does, an exception is
+ *
+ * Copied data is stored in memory chunks allocated on region
+ * allocator. Chunk size grows by a factor of 2. With this growth
+ * factor, the number of used chunks is unlikely to ever exceed
+ * the hard limit of OBUF_CHUNK_MAX. If it does, an exception is
  * raised.
+ *
+ * Besides copies, the buffer can reference external memory, see
+ * obuf_add_ref(). Each reference takes its own iovec, so the
+ * iovec array is not bound to the chunks and grows on demand.
  */
 struct obuf
 {
@@ -115,20 +125,46 @@ struct obuf
 	size_t pos;
 	/** Allocation factor (allocations are a multiple of this number) */
 	size_t alloc_factor;
-	/** How many bytes are actually allocated for each iovec. */
-	size_t capacity[IOBUF_IOV_MAX];
+	/** The "current" chunk, copied data is appended to it. */
+	size_t chunk_pos;
+	/** How many bytes are used in the current chunk. */
+	size_t chunk_used;
+	/**
+	 * Memory chunks, each chunk is at least twice as big
+	 * as the previous one. Chunks are reused after
+	 * obuf_reset().
+	 */
+	char *chunk[OBUF_CHUNK_MAX];
+	/** How many bytes are actually allocated for each chunk. */
+	size_t capacity[OBUF_CHUNK_MAX];
 	/**
-	 * List of iovec vectors, each vector is at least twice
-	 * as big as the previous one. The vector following the
-	 * last allocated one is always zero-initialized
-	 * (iov_base = NULL, iov_len = 0).
+	 * List of iovec vectors. The current vector, iov[pos],
+	 * is either empty or ends exactly at the end of the
+	 * used part of the current chunk.
 	 */
-	struct iovec iov[IOBUF_IOV_MAX];
+	struct iovec *iov;
+	/** How many vectors fit into iov. */
+	size_t iov_capacity;
+	/**
+	 * Objects referenced by the buffer and not yet
+	 * released, see obuf_add_ref().
+	 */
+	void **refs;
+	size_t ref_count;
+	size_t ref_capacity;
+	/** How many references have been released. */
+	size_t ref_released;
+	/** Initial storage for iov. */
+	struct iovec iov_buf[OBUF_IOV_MIN];
 };
 
 void
 obuf_create(struct obuf *buf, struct region *pool, size_t alloc_factor);
 
+/** Mark an output buffer as empty, keeping its memory. */
+void
+obuf_reset(struct obuf *buf);
+
 /** How many bytes are in the output buffer. */
 static inline size_t
 obuf_size(struct obuf *obuf)
@@ -154,6 +190,17 @@ struct obuf_svp
 	size_t pos;
 	size_t iov_len;
 	size_t size;
+	size_t chunk_pos;
+	size_t chunk_used;
+	/**
+	 * The iovec array as of the savepoint. A savepoint
+	 * passed to another cord gives it a consistent view
+	 * of the vectors up to pos, even if the buffer has
+	 * moved to a larger array since.
+	 */
+	struct iovec *iov;
+	/** How many references have been added so far. */
+	size_t refs;
 };
 
 void
@@ -171,10 +218,9 @@ obuf_ensure_resize(struct obuf *buf, size_t size);
 static inline char *
 obuf_ensure(struct obuf *buf, size_t size)
 {
-	if (buf->iov[buf->pos].iov_len + size > buf->capacity[buf->pos])
+	if (buf->chunk_used + size > buf->capacity[buf->chunk_pos])
 		obuf_ensure_resize(buf, size);
-	struct iovec *iov = &buf->iov[buf->pos];
-	return (char *) iov->iov_base + iov->iov_len;
+	return buf->chunk[buf->chunk_pos] + buf->chunk_used;
 }
 
 /**
@@ -187,8 +233,9 @@ static inline void
 obuf_advance(struct obuf *buf, size_t size)
 {
 	buf->iov[buf->pos].iov_len += size;
+	buf->chunk_used += size;
 	buf->size += size;
-	assert(buf->iov[buf->pos].iov_len <= buf->capacity[buf->pos]);
+	assert(buf->chunk_used <= buf->capacity[buf->chunk_pos]);
 }
 
 /**
@@ -211,6 +258,26 @@ obuf_book(struct obuf *obuf, size_t size);
 void
 obuf_dup(struct obuf *obuf, const void *data, size_t size);
 
+/**
+ * Append data to the output buffer without copying it.
+ * The data must stay intact until the buffer is written out.
+ * \a ref is remembered in the buffer and passed to the unref
+ * callback of obuf_release_refs(), which must be called once
+ * the data is no longer in use.
+ * Adds nothing if it throws.
+ */
+void
+obuf_add_ref(struct obuf *buf, const void *data, size_t size, void *ref);
+
+/**
+ * Call \a unref for the references added to the buffer before
+ * the savepoint and forget them. References which have already
+ * been released are skipped.
+ */
+void
+obuf_release_refs(struct obuf *buf, struct obuf_svp *svp,
+		  void (*unref)(void *));
+
 static inline struct obuf_svp
 obuf_create_svp(struct obuf *buf)
 {
@@ -218,9 +285,31 @@ obuf_create_svp(struct obuf *buf)
 	svp.pos = buf->pos;
 	svp.iov_len = buf->iov[buf->pos].iov_len;
 	svp.size = buf->size;
+	svp.chunk_pos = buf->chunk_pos;
+	svp.chunk_used = buf->chunk_used;
+	svp.iov = buf->iov;
+	svp.refs = buf->ref_released + buf->ref_count;
 	return svp;
 }
 
+/**
+ * Move the savepoint to the start of the buffer after
+ * obuf_reset(). Unlike obuf_create_svp(), doesn't look at
+ * the references of the buffer, which may be released by
+ * their owner concurrently.
+ */
+static inline void
+obuf_svp_reset(struct obuf *buf, struct obuf_svp *svp)
+{
+	assert(buf->pos == 0 && buf->size == 0);
+	svp->pos = 0;
+	svp->iov_len = 0;
+	svp->size = 0;
+	svp->chunk_pos = 0;
+	svp->chunk_used = 0;
+	svp->iov = buf->iov;
+}
+
 /** Convert a savepoint position to a pointer in the buffer. */
 static inline void *
 obuf_svp_to_ptr(struct obuf *buf, struct obuf_svp *svp)
@@ -266,6 +355,11 @@ struct iobuf
 	/** Output buffer. */
 	struct obuf out;
 	struct region pool;
+	/**
+	 * Memory of the output buffer of an iobuf shared
+	 * by two cords, see iobuf_new_mt(). Unused otherwise.
+	 */
+	struct region out_pool;
 };
 
 /** Create an instance of input/output buffer. */
@@ -276,6 +370,31 @@ iobuf_new(const char *name);
 void
 iobuf_delete(struct iobuf *iobuf);
 
+/**
+ * Create an input/output buffer shared by two cords. The input
+ * buffer is allocated in the current cord, the output buffer
+ * uses \a slabc_out of the cord which produces the output.
+ * Such buffers are not cached.
+ */
+struct iobuf *
+iobuf_new_mt(const char *name, struct slab_cache *slabc_out);
+
+/**
+ * Release memory of the output buffer of an iobuf created
+ * with iobuf_new_mt(). Must be called in the cord which
+ * owns the output slab cache, before iobuf_delete_mt().
+ * References of the output buffer must be released first.
+ */
+void
+iobuf_delete_out(struct iobuf *iobuf);
+
+/**
+ * Destroy an iobuf created with iobuf_new_mt(). Must be
+ * called in the cord which created it.
+ */
+void
+iobuf_delete_mt(struct iobuf *iobuf);
+
 /** Flush output using cooperative I/O and garbage collect.
  * @return number of bytes written
  */
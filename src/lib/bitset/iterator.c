@@ -327,11 +327,34 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 	}
 }
 
+/**
+ * Sort conjunctions by page_first_pos. Only the conjunctions from the
+ * head of the array are moved forward on each page switch, so the
+ * array is almost sorted here and an insertion sort beats qsort().
+ */
+static void
+bitset_iterator_sort_conjs(struct bitset_iterator *it)
+{
+	for (size_t c = 1; c < it->size; c++) {
+		if (bitset_iterator_conj_cmp(&it->conjs[c - 1],
+					     &it->conjs[c]) <= 0)
+			continue;
+
+		struct bitset_iterator_conj conj = it->conjs[c];
+		size_t i = c;
+		do {
+			it->conjs[i] = it->conjs[i - 1];
+			i--;
+		} while (i > 0 &&
+			 bitset_iterator_conj_cmp(&it->conjs[i - 1], &conj) > 0);
+		it->conjs[i] = conj;
+	}
+}
+
 static void
 bitset_iterator_prepare_page(struct bitset_iterator *it)
 {
-	qsort(it->conjs, it->size, sizeof(*it->conjs),
-	      bitset_iterator_conj_cmp);
+	bitset_iterator_sort_conjs(it);
 
 	bitset_page_set_zeros(it->page);
 	if (it->size > 0) {
@@ -423,3 +446,25 @@ bitset_iterator_next(struct bitset_iterator *it)
 		bitset_iterator_next_page(it);
 	}
 }
+
+size_t
+bitset_iterator_next_batch(struct bitset_iterator *it, size_t *pos,
+			   size_t size)
+{
+	assert(it != NULL);
+
+	size_t count = 0;
+	while (count < size && it->page->first_pos != SIZE_MAX) {
+		size_t first_pos = it->page->first_pos;
+		size_t p;
+		while (count < size &&
+		       (p = bit_iterator_next(&it->page_it)) != SIZE_MAX) {
+			pos[count++] = first_pos + p;
+		}
+
+		if (count < size)
+			bitset_iterator_next_page(it);
+	}
+
+	return count;
+}
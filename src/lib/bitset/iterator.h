@@ -133,6 +133,21 @@ bitset_iterator_rewind(struct bitset_iterator *it);
 size_t
 bitset_iterator_next(struct bitset_iterator *it);
 
+/**
+ * @brief Move \a it up to \a size positions forward at once.
+ * Saves a call per position on dense result sets.
+ * @param it bitset iterator
+ * @param[out] pos array to store the next offsets where the expression
+ * evaluates to true
+ * @param size capacity of \a pos
+ * @return the number of offsets stored to \a pos. A value less than
+ * \a size means there is no more bits in the result set.
+ * @see @link bitset_iterator_next @endlink
+ */
+size_t
+bitset_iterator_next_batch(struct bitset_iterator *it, size_t *pos,
+			   size_t size);
+
 #if defined(__cplusplus)
 }
 #endif /* defined(__cplusplus) */
@@ -56,10 +56,18 @@ enum {
 	BITSET_PAGE_DATA_SIZE = 160
 };
 
-#if defined(ENABLE_AVX)
+/*
+ * Page kernels (AND, NAND, OR) operate on the widest vector word
+ * the target supports. ENABLE_AVX and ENABLE_SSE2 only add -mavx and
+ * -msse2 to the compiler flags, so check the macros predefined by the
+ * compiler for the instruction set.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
 typedef __m256i bitset_word_t;
 #define BITSET_PAGE_DATA_ALIGNMENT 32
-#elif defined(ENABLE_SSE2)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
 typedef __m128i bitset_word_t;
 #define BITSET_PAGE_DATA_ALIGNMENT 16
 #elif defined(__x86_64__)
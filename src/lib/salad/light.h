@@ -200,6 +200,19 @@ LIGHT(find)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_DATA_TYPE data);
 uint32_t
 LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE data);
 
+/**
+ * @brief Prefetch the head of the chain of given hash, and the value
+ * stored there if its hash matches. Issue it for several hashes
+ * before looking them up to overlap the cache misses.
+ * @param ht - pointer to a hash table struct
+ * @param hash - hash to prefetch
+ * @param prefetch_value - prefetch the memory the value points to,
+ *  LIGHT_DATA_TYPE must be a pointer then
+ */
+void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash,
+		bool prefetch_value);
+
 /**
  * @brief Insert a record with given hash and value
  * @param ht - pointer to a hash table struct
@@ -360,6 +373,23 @@ LIGHT(find_key)(const struct LIGHT(core) *ht, uint32_t hash, LIGHT_KEY_TYPE key)
 	return LIGHT(end);
 }
 
+inline void
+LIGHT(prefetch)(const struct LIGHT(core) *ht, uint32_t hash,
+		bool prefetch_value)
+{
+	if (ht->count == 0)
+		return;
+	uint32_t slot = LIGHT(slot)(ht, hash);
+	struct LIGHT(record) *record = (struct LIGHT(record) *)
+		matras_get(&ht->mtable, slot);
+	if (!prefetch_value) {
+		__builtin_prefetch(record);
+		return;
+	}
+	if (record->next != slot && record->hash == hash)
+		__builtin_prefetch((const void *) (uintptr_t) record->value);
+}
+
 inline uint32_t
 LIGHT(get_empty_prev)(struct LIGHT(record) *record)
 {
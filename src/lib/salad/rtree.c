@@ -27,6 +27,7 @@
  * SUCH DAMAGE.
  */
 #include "rtree.h"
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -807,6 +808,121 @@ rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj)
 }
 
 
+/*------------------------------------------------------------------------- */
+/* R-tree bulk load (Sort-Tile-Recursive) */
+/*------------------------------------------------------------------------- */
+
+static int
+rtree_bulk_entry_cmp(const struct rtree_bulk_entry *e1,
+		     const struct rtree_bulk_entry *e2, int dim)
+{
+	/* Compare doubled centers of the rectangles */
+	coord_t c1 = e1->rect.lower_point.coords[dim] +
+		e1->rect.upper_point.coords[dim];
+	coord_t c2 = e2->rect.lower_point.coords[dim] +
+		e2->rect.upper_point.coords[dim];
+	return c1 < c2 ? -1 : c1 > c2;
+}
+
+static int
+rtree_bulk_entry_cmp_x(const void *p1, const void *p2)
+{
+	return rtree_bulk_entry_cmp((const struct rtree_bulk_entry *)p1,
+				    (const struct rtree_bulk_entry *)p2, 0);
+}
+
+static int
+rtree_bulk_entry_cmp_y(const void *p1, const void *p2)
+{
+	return rtree_bulk_entry_cmp((const struct rtree_bulk_entry *)p1,
+				    (const struct rtree_bulk_entry *)p2, 1);
+}
+
+static void
+rtree_bulk_sort_dim(struct rtree_bulk_entry *entries, size_t count, int dim)
+{
+	static int (*const cmp[])(const void *, const void *) = {
+		rtree_bulk_entry_cmp_x, rtree_bulk_entry_cmp_y
+	};
+	assert(RTREE_DIMENSION == 2);
+	qsort(entries, count, sizeof(*entries), cmp[dim]);
+	if (dim + 1 == RTREE_DIMENSION)
+		return;
+	/*
+	 * Cut the entries into n_slabs slabs along this dimension,
+	 * where n_slabs is the (RTREE_DIMENSION - dim)-th root of
+	 * the number of pages, and sort every slab along the
+	 * remaining dimensions. A slab holds a whole number of
+	 * full pages.
+	 */
+	size_t n_pages = (count + RTREE_MAX_FILL - 1) / RTREE_MAX_FILL;
+	size_t n_slabs = 1;
+	while (true) {
+		size_t p = 1;
+		for (int i = dim; i < RTREE_DIMENSION; i++)
+			p *= n_slabs;
+		if (p >= n_pages)
+			break;
+		n_slabs++;
+	}
+	size_t slab = (n_pages + n_slabs - 1) / n_slabs * RTREE_MAX_FILL;
+	for (size_t i = 0; i < count; i += slab) {
+		size_t n = count - i < slab ? count - i : slab;
+		rtree_bulk_sort_dim(entries + i, n, dim + 1);
+	}
+}
+
+void
+rtree_bulk_sort(struct rtree_bulk_entry *entries, size_t count)
+{
+	rtree_bulk_sort_dim(entries, count, 0);
+}
+
+void
+rtree_bulk_load(struct rtree *tree, struct rtree_bulk_entry *entries,
+		size_t count)
+{
+	assert(tree->root == NULL);
+	if (count == 0)
+		return;
+	/*
+	 * Pack the sorted entries of a level into full pages,
+	 * replace the entries with the page covers in place and
+	 * repeat for the next level up to the root.
+	 */
+	size_t n = count;
+	while (true) {
+		size_t n_pages = 0;
+		for (size_t i = 0; i < n; n_pages++) {
+			size_t fill = n - i;
+			if (fill > RTREE_MAX_FILL + RTREE_MIN_FILL)
+				fill = RTREE_MAX_FILL;
+			else if (fill > RTREE_MAX_FILL)
+				/* Do not leave an underfilled last page */
+				fill /= 2;
+			struct rtree_page *page = rtree_alloc_page(tree);
+			tree->n_pages++;
+			page->n = fill;
+			for (size_t j = 0; j < fill; j++) {
+				page->b[j].rect = entries[i + j].rect;
+				page->b[j].data.record = entries[i + j].record;
+			}
+			i += fill;
+			entries[n_pages].rect = rtree_page_cover(page);
+			entries[n_pages].record = page;
+		}
+		tree->height++;
+		assert(tree->height <= RTREE_MAX_HEIGHT);
+		if (n_pages == 1)
+			break;
+		n = n_pages;
+		rtree_bulk_sort(entries, n);
+	}
+	tree->root = (struct rtree_page *)entries[0].record;
+	tree->n_records = count;
+	tree->version++;
+}
+
 bool
 rtree_remove(struct rtree *tree, const struct rtree_rect *rect, record_t obj)
 {
@@ -111,6 +111,15 @@ struct rtree_rect
 typedef bool (*rtree_comparator_t)(const struct rtree_rect *rt1,
 				   const struct rtree_rect *rt2);
 
+/* A record with its rectangle, an element of bulk load input */
+struct rtree_bulk_entry
+{
+	/* rectangle of the record */
+	struct rtree_rect rect;
+	/* record itself */
+	record_t record;
+};
+
 /* Main rtree struct */
 struct rtree
 {
@@ -239,6 +248,29 @@ rtree_search(const struct rtree *tree, const struct rtree_rect *rect,
 void
 rtree_insert(struct rtree *tree, struct rtree_rect *rect, record_t obj);
 
+/**
+ * @brief Sort records in Sort-Tile-Recursive order, which
+ * rtree_bulk_load() expects. Touches nothing but the array,
+ * so may be called from any thread.
+ * @param entries - array of records to sort
+ * @param count - number of records in the array
+ */
+void
+rtree_bulk_sort(struct rtree_bulk_entry *entries, size_t count);
+
+/**
+ * @brief Build a tree from records sorted with rtree_bulk_sort().
+ * Pages are packed full, so the tree is built much faster and with
+ * less overlap between pages than by inserting records one by one.
+ * @param tree - pointer to an empty tree
+ * @param entries - array of records, used as scratch space
+ * and spoiled on return
+ * @param count - number of records in the array
+ */
+void
+rtree_bulk_load(struct rtree *tree, struct rtree_bulk_entry *entries,
+		size_t count);
+
 /**
  * @brief Remove the record from a tree
  * @return true if the record deleted (false otherwise)
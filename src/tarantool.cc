@@ -140,7 +140,7 @@ static void
 sig_snapshot(ev_loop * /* loop */, struct ev_signal * /* w */,
 	     int /* revents */)
 {
-	if (snapshot_pid) {
+	if (box_snapshot_is_in_progress()) {
 		say_warn("Snapshot process is already running,"
 			" the signal is ignored");
 		return;
@@ -65,6 +65,10 @@
 #ifndef HAVE_FDATASYNC
 	#define fdatasync fsync
 #endif
+/*
+ * Defined if posix_fadvise(2) call is present.
+ */
+#cmakedefine HAVE_POSIX_FADVISE 1
 
 /*
  * Defined if this platform has BSD specific funopen()
@@ -167,7 +167,18 @@ test('space:auto_increment({"transaction"})')
 test('space:select{}')
 test('box.begin(), space:auto_increment({"failed"}), box.rollback()')
 test('space:select{}')
+# Iterators
+admin("function f(...) return space:pairs() end")
+lua_call('f')
+admin("function f(...) return ipairs({1, {2, 3}, 'x'}) end")
+lua_call('f')
+# A plain function is an iterator too: called until it returns nil
+admin("function f(...) local i = 0 return function() i = i + 1 if i <= 2 then return i end end end")
+lua_call('f')
 test('require("fiber").sleep(0)')
+# A callable table is not an iterator: it is sent as a tuple
+admin("function f(...) return setmetatable({1, 2}, {__call = function() end}) end")
+lua_call('f')
 # Other
 lua_eval('!invalid expression')
 
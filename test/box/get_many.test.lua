@@ -0,0 +1,31 @@
+-- index:get_many() returns the tuple found by each key, nil for a miss
+function found(ret, count) local r = {} for i = 1, count do r[i] = ret[i] ~= nil and ret[i][1] or 'nil' end return table.concat(r, ',') end
+
+s = box.schema.space.create('get_many')
+hash = s:create_index('primary', { type = 'hash' })
+pair = s:create_index('pair', { type = 'hash', parts = {1, 'num', 3, 'num'} })
+tree = s:create_index('tree', { type = 'tree', parts = {2, 'num'} })
+multi = s:create_index('multi', { type = 'tree', unique = false, parts = {3, 'num'} })
+for i = 1, 50 do s:insert{i * 2, i * 2, i * 2 % 5} end
+
+s:get_many({})
+found(s:get_many({2, 3, {4}, 100, 101}), 5)
+found(pair:get_many({{2, 2}, {2, 1}, {10, 0}}), 3)
+
+-- more keys than a probe batch of the hash index
+keys = {}
+for i = 1, 40 do keys[i] = 41 - i end
+found(hash:get_many(keys), 40)
+
+-- TREE falls back to a lookup per key
+found(tree:get_many({2, 3, {4}, 100, 101}), 5)
+found(tree:get_many(keys), 40)
+
+-- errors
+multi:get_many({1})
+s:get_many({1, {1, 2}})
+s:get_many({1, {}})
+s:get_many({'a'})
+pair:get_many({{2, 2}, {2}})
+
+s:drop()
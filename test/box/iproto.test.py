@@ -1,11 +1,12 @@
 import os
 import sys
 import struct
+import time
 import socket
 import msgpack
 from tarantool.const import *
 from tarantool import Connection
-from tarantool.request import Request, RequestInsert, RequestSelect
+from tarantool.request import Request, RequestInsert, RequestSelect, RequestCall
 from tarantool.response import Response
 from lib.tarantool_connection import TarantoolConnection
 
@@ -148,6 +149,19 @@ print response2.__str__()
 
 c.close()
 
+# Requests of a client which is gone are not executed: keep TX
+# busy while the client sends two inserts and disconnects.
+admin("function busy() local t = os.clock() + 0.3 while os.clock() < t do end end")
+c = Connection('localhost', server.sql.port)
+c.connect()
+s = c._socket
+s.send(bytes(RequestCall(c, 'busy', [])) +
+       bytes(RequestInsert(c, 567, [5, "gone"])) +
+       bytes(RequestInsert(c, 567, [6, "gone"])))
+s.close()
+time.sleep(0.5)
+admin("space:len()")
+
 admin("space:drop()")
 
 #
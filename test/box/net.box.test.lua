@@ -344,4 +344,35 @@ end;
 --# setopt delimiter ''
 
 file_log:close()
+
+-- large tuples are sent by reference and unpinned once written
+--# setopt delimiter ';'
+function big_items()
+    local n = 0
+    for _, slab in pairs(box.slab.info().slabs) do
+        if slab.item_size > 4096 then
+            n = n + slab.item_count
+        end
+    end
+    return n
+end;
+--# setopt delimiter ''
+items = big_items()
+space = box.schema.space.create('net_box_big')
+index = space:create_index('primary')
+for i = 1, 100 do space:insert{i, string.rep('x', 5000)} end
+big_items() - items
+cn = remote:new(LISTEN.host, LISTEN.service)
+r = cn.space.net_box_big:select{}
+#r, r[1][1], r[100][1], #r[50][2]
+r = cn.space.net_box_big:select({}, { limit = 3 })
+#r, r[3][1]
+r = nil
+-- the connection is idle, the tuples are freed with the space
+space:truncate()
+for i = 1, 100 do if big_items() == items then break end fiber.sleep(0.01) end
+big_items() - items
+cn:close()
+space:drop()
+
 box.schema.user.revoke('guest', 'read,write,execute', 'universe')
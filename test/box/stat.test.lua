@@ -29,5 +29,37 @@ box.stat.UPDATE.total
 box.stat.REPLACE.total
 box.stat.SELECT.total
 
+-- box.stat.latency() is reset on restart as well
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+--# stop server default
+--# start server default
+function keys(t) local r = {} for k in pairs(t) do table.insert(r, k) end table.sort(r) return r end
+lat = box.stat.latency()
+keys(lat)
+keys(lat.INSERT)
+lat.INSERT.count, lat.WAL.count, lat.space.tweedledum == nil
+net = require('net.box')
+c = net:new(box.cfg.listen)
+c:ping()
+before = box.stat.latency()
+for i = 11, 15 do c.space.tweedledum:insert{i} end
+_ = c.space.tweedledum:replace{1, 'a'}
+_ = c.space.tweedledum:select{}
+after = box.stat.latency()
+after.INSERT.count - before.INSERT.count
+after.REPLACE.count - before.REPLACE.count
+after.SELECT.count - before.SELECT.count
+after.DELETE.count - before.DELETE.count
+after.WAL.count - before.WAL.count
+after.INSERT.max > 0, after.INSERT.max >= after.INSERT.p50
+after.space.tweedledum.count
+-- per-space latency survives ALTER
+index2 = box.space.tweedledum:create_index('second', { type = 'tree' })
+box.stat.latency().space.tweedledum.count
+_ = box.space.tweedledum:insert{16}
+box.stat.latency().space.tweedledum.count
+c:close()
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
+
 -- cleanup
 box.space.tweedledum:drop()
@@ -0,0 +1,64 @@
+import os
+from lib.tarantool_server import TarantoolServer
+
+# A replica applies the rows read from the master in fibers of
+# their own, many rows in flight at once.
+
+# master server
+master = server
+master_id = master.get_param('server')['id']
+
+master.admin("box.schema.user.grant('guest', 'replication')")
+master.admin("space = box.schema.space.create('test')")
+master.admin("index = space:create_index('primary')")
+
+replica = TarantoolServer(server.ini)
+replica.script = 'replication/replica.lua'
+replica.vardir = os.path.join(server.vardir, 'replica')
+replica.rpl_master = master
+replica.deploy()
+replica.wait_lsn(master_id, master.get_lsn(master_id))
+
+print '-------------------------------------------------------------'
+print 'more rows than may be in flight at once'
+print '-------------------------------------------------------------'
+
+master.admin("for i = 1, 1000 do box.space.test:insert{i} end")
+replica.wait_lsn(master_id, master.get_lsn(master_id))
+replica.admin("box.space.test:len()")
+replica.admin("box.space.test:get{1}")
+replica.admin("box.space.test:get{1000}")
+replica.admin("box.info.replication.status")
+
+print '-------------------------------------------------------------'
+print 'rows which yield before they get into the WAL'
+print '-------------------------------------------------------------'
+
+replica.admin("fiber = require('fiber')")
+replica.admin("trigger = box.space.test:on_replace(function() fiber.sleep(0) end)")
+master.admin("for i = 1, 100 do box.space.test:update({i}, {{'=', 2, i}}) end")
+replica.wait_lsn(master_id, master.get_lsn(master_id))
+replica.admin("box.space.test:get{1}")
+replica.admin("box.space.test:get{100}")
+replica.admin("box.space.test:get{101}")
+replica.admin("_ = box.space.test:on_replace(nil, trigger)")
+
+print '-------------------------------------------------------------'
+print 'the replica stops and starts following the master again'
+print '-------------------------------------------------------------'
+
+master.admin("for i = 1001, 1500 do box.space.test:insert{i} end", silent=True)
+replica.admin("box.cfg{replication_source=''}", silent=True)
+replica.admin("box.info.replication.status")
+master.admin("for i = 1501, 2000 do box.space.test:insert{i} end")
+replica.admin("box.cfg{replication_source='%s'}" % master.sql.uri, silent=True)
+replica.wait_lsn(master_id, master.get_lsn(master_id))
+replica.admin("box.space.test:len()")
+replica.admin("box.space.test:get{2000}")
+replica.admin("box.info.replication.status")
+
+# Cleanup.
+replica.stop()
+replica.cleanup(True)
+server.stop()
+server.deploy()
@@ -0,0 +1,74 @@
+import os
+from lib.tarantool_server import TarantoolServer
+
+# A replica which reconnects to a master must get all rows it
+# hasn't seen, even if the rows of another server it has seen
+# come later in the master's WAL.
+
+def replica_new(name):
+    replica = TarantoolServer(server.ini)
+    replica.script = 'replication/replica.lua'
+    replica.vardir = os.path.join(server.vardir, name)
+    replica.rpl_master = master
+    replica.deploy()
+    replica.wait_lsn(master_id, master.get_lsn(master_id))
+    return replica
+
+# master server
+master = server
+master_id = master.get_param('server')['id']
+
+master.admin("box.schema.user.grant('guest', 'replication')")
+master.admin("space = box.schema.space.create('test')")
+master.admin("index = space:create_index('primary')")
+
+# the second master, the reconnecting replica and a replica
+# which keeps the master's WAL tail active
+master2 = replica_new('master2')
+replica = replica_new('replica')
+watcher = replica_new('watcher')
+master2_id = master2.get_param('server')['id']
+
+print '-------------------------------------------------------------'
+print 'the master follows master2, the replica follows master2'
+print '-------------------------------------------------------------'
+
+master2.admin("box.cfg{replication_source=''}", silent=True)
+master.admin("box.cfg{replication_source='%s'}" % master2.sql.uri, silent=True)
+replica.admin("box.cfg{replication_source='%s'}" % master2.sql.uri, silent=True)
+watcher.stop()
+
+print '-------------------------------------------------------------'
+print 'rows on the master which only the master has'
+print '-------------------------------------------------------------'
+
+master.admin("for i = 1, 50 do box.space.test:insert{i} end")
+
+print '-------------------------------------------------------------'
+print 'rows on master2 which the replica sees first'
+print '-------------------------------------------------------------'
+
+watcher.start()
+watcher.wait_lsn(master_id, master.get_lsn(master_id))
+master2.admin("for i = 51, 60 do box.space.test:insert{i} end")
+replica.wait_lsn(master2_id, master2.get_lsn(master2_id))
+master.wait_lsn(master2_id, master2.get_lsn(master2_id))
+
+print '-------------------------------------------------------------'
+print 'the replica reconnects to the master'
+print '-------------------------------------------------------------'
+
+replica.admin("box.cfg{replication_source='%s'}" % master.sql.uri, silent=True)
+master.admin("box.space.test:insert{61}")
+replica.admin("fiber = require('fiber')")
+replica.admin("for i = 1, 1000 do if box.space.test:get{61} then break end fiber.sleep(0.01) end")
+replica.admin("box.space.test:len()")
+replica.admin("box.space.test:get{1}")
+replica.admin("box.space.test:get{50}")
+
+# Cleanup.
+for s in (watcher, replica, master2):
+    s.stop()
+    s.cleanup(True)
+server.stop()
+server.deploy()
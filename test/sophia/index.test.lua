@@ -0,0 +1,74 @@
+
+-- multipart primary key
+
+space = box.schema.space.create('test', { engine = 'sophia' })
+index = space:create_index('primary', { type = 'tree', parts = {1, 'num', 2, 'str'} })
+space:insert({1, 'a', 1})
+space:insert({1, 'b', 2})
+space:insert({2, 'a', 3})
+space:insert({1, 'a', 4})
+space:get({1, 'b'})
+index:select({1})
+index:select({1}, {iterator = box.index.GT})
+index:select({1, 'a'}, {iterator = box.index.GT})
+index:select({2}, {iterator = box.index.LT})
+index:select({1}, {iterator = box.index.LE})
+index:select({}, {iterator = box.index.ALL})
+space:drop()
+_ = sophia_schedule()
+
+-- secondary indexes
+
+space = box.schema.space.create('test', { engine = 'sophia' })
+primary = space:create_index('primary', { type = 'tree', parts = {1, 'num'} })
+secondary = space:create_index('secondary', { type = 'tree', unique = false, parts = {2, 'str'} })
+unique = space:create_index('unique', { type = 'tree', parts = {3, 'num'} })
+space:insert({1, 'a', 10})
+space:insert({2, 'b', 20})
+space:insert({3, 'a', 30})
+space:insert({4, 'c', 10})
+secondary:select({'a'})
+unique:get({20})
+space:replace({1, 'b', 11})
+secondary:select({'a'})
+secondary:select({'b'})
+unique:get({10})
+unique:get({11})
+space:update({2}, {{'=', 3, 21}})
+unique:get({20})
+unique:get({21})
+space:delete({3})
+secondary:select({'a'})
+unique:select({}, {iterator = box.index.ALL})
+space:drop()
+_ = sophia_schedule()
+
+-- get_many
+
+function found(ret, count) local r = {} for i = 1, count do r[i] = ret[i] ~= nil and ret[i][1] or 'nil' end return table.concat(r, ',') end
+space = box.schema.space.create('test', { engine = 'sophia' })
+index = space:create_index('primary', { type = 'tree', parts = {1, 'num'} })
+for i = 1, 20 do space:insert({i * 2}) end
+keys = {}
+for i = 1, 40 do keys[i] = i end
+found(space:get_many(keys), 40)
+space:get_many({})
+space:get_many({'a'})
+space:drop()
+_ = sophia_schedule()
+
+-- rebuild of a secondary index with new parts
+
+space = box.schema.space.create('test', { engine = 'sophia' })
+primary = space:create_index('primary', { type = 'tree', parts = {1, 'num'} })
+secondary = space:create_index('secondary', { type = 'tree', parts = {2, 'num'} })
+space.index.secondary:alter({ parts = {3, 'str'} })
+space:insert({1, 10, 'c'})
+space:insert({2, 20, 'a'})
+space:insert({3, 30, 'b'})
+space.index.secondary:select({}, {iterator = box.index.ALL})
+space.index.secondary:get({'b'})
+space.index.secondary:alter({ parts = {2, 'num'} })
+space.index.secondary:get({'b'})
+space:drop()
+_ = sophia_schedule()
@@ -0,0 +1,29 @@
+-- secondary indexes after restart
+
+space = box.schema.space.create('test', { engine = 'sophia' })
+primary = space:create_index('primary', { type = 'tree', parts = {1, 'num'} })
+secondary = space:create_index('secondary', { type = 'tree', unique = false, parts = {2, 'str'} })
+unique = space:create_index('unique', { type = 'tree', parts = {3, 'num'} })
+space:insert({1, 'a', 10})
+space:insert({2, 'b', 20})
+space:insert({3, 'a', 30})
+space:update({2}, {{'=', 3, 21}})
+space:delete({3})
+
+os.execute("touch lock")
+
+--# stop server default
+--# start server default
+
+space = box.space['test']
+space.index.secondary:select({'a'})
+space.index.secondary:select({'b'})
+space.index.unique:select({}, {iterator = box.index.ALL})
+space.index.unique:get({20})
+space:insert({4, 'c', 21})
+space:insert({4, 'c', 40})
+space.index.secondary:select({}, {iterator = box.index.ALL})
+space:drop()
+_ = sophia_schedule()
+
+os.execute("rm -f lock")
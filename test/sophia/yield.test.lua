@@ -0,0 +1,26 @@
+-- reads yield to the coeio thread pool
+
+fiber = require('fiber')
+space = box.schema.space.create('test', { engine = 'sophia' })
+index = space:create_index('primary', { type = 'tree', parts = {1, 'num'} })
+for i = 1, 100 do space:insert({i}) end
+ch = fiber.channel(2)
+
+-- get() and pairs() from two fibers at once
+
+function getter() local n = 0 for i = 1, 100 do n = n + space:get(i)[1] end ch:put(n) end
+f1 = fiber.create(getter)
+f2 = fiber.create(getter)
+ch:get(), ch:get()
+function scanner() local n = 0 for _, t in space:pairs() do n = n + t[1] end ch:put(n) end
+f1 = fiber.create(scanner)
+f2 = fiber.create(scanner)
+ch:get(), ch:get()
+
+-- drop does not wait for a fiber which keeps reading
+
+function reader() local ok = pcall(function() while true do for _, t in space:pairs() do end end end) ch:put(ok) end
+f1 = fiber.create(reader)
+space:drop()
+ch:get()
+_ = sophia_schedule()
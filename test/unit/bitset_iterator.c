@@ -474,6 +474,61 @@ void test_disjunction()
 	footer();
 }
 
+static
+void test_batch()
+{
+	header();
+
+	enum { BITSETS_SIZE = 4, BATCH_SIZE = 100 };
+
+	struct bitset **bitsets = bitsets_create(BITSETS_SIZE);
+
+	nums_shuffle(NUMS, NUMS_SIZE);
+
+	for (size_t i = 0; i < NUMS_SIZE; i++) {
+		bitset_set(bitsets[i % BITSETS_SIZE], NUMS[i]);
+	}
+
+	struct bitset_expr expr;
+	bitset_expr_create(&expr, realloc);
+
+	for (size_t b = 0; b < BITSETS_SIZE; b++) {
+		fail_unless(bitset_expr_add_conj(&expr) == 0);
+		fail_unless(bitset_expr_add_param(&expr, b, false) == 0);
+	}
+
+	nums_sort(NUMS, NUMS_SIZE);
+
+	struct bitset_iterator it;
+	bitset_iterator_create(&it, realloc);
+	fail_unless(bitset_iterator_init(&it, &expr, bitsets, BITSETS_SIZE) == 0);
+	bitset_expr_destroy(&expr);
+
+	size_t batch[BATCH_SIZE];
+	size_t i = 0;
+	while (true) {
+		size_t count = bitset_iterator_next_batch(&it, batch,
+							  BATCH_SIZE);
+		fail_unless(count == BATCH_SIZE || count == NUMS_SIZE - i);
+		for (size_t j = 0; j < count; j++) {
+			fail_unless(batch[j] == NUMS[i++]);
+		}
+		if (count < BATCH_SIZE)
+			break;
+	}
+	fail_unless(i == NUMS_SIZE);
+
+	fail_unless(bitset_iterator_next_batch(&it, batch, BATCH_SIZE) == 0);
+	size_t pos = bitset_iterator_next(&it);
+	fail_unless(pos == SIZE_MAX);
+
+	bitset_iterator_destroy(&it);
+
+	bitsets_destroy(bitsets, BITSETS_SIZE);
+
+	footer();
+}
+
 int main(void)
 {
 	setbuf(stdout, NULL);
@@ -489,6 +544,7 @@ int main(void)
 	test_not_empty();
 	test_not_last();
 	test_disjunction();
+	test_batch();
 
 	return 0;
 }
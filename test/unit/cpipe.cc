@@ -0,0 +1,115 @@
+#include "memory.h"
+#include "fiber.h"
+#include "cpipe.h"
+#include "unit.h"
+
+enum { MESSAGES = 10000, BATCH = 100 };
+
+/** Messages from the worker to the main cord. */
+static struct cpipe main_pipe;
+/** Messages from the main cord to the worker. */
+static struct cpipe worker_pipe;
+
+static struct cord worker;
+
+struct test_msg {
+	struct cmsg base;
+	int value;
+};
+
+static struct test_msg msgs[MESSAGES];
+static struct cmsg hello, stop;
+
+/** Values seen by the worker and by the main cord. */
+static int worker_next, main_next;
+static bool out_of_order;
+
+static void
+main_receive(struct cmsg *m);
+
+static void
+worker_bounce(struct cmsg *m)
+{
+	struct test_msg *msg = (struct test_msg *) m;
+	if (msg->value != worker_next++)
+		out_of_order = true;
+	/* Send the message back, to be handled by the main cord. */
+	cmsg_init(m, main_receive);
+	cpipe_push(&main_pipe, m);
+	cpipe_flush(&main_pipe);
+}
+
+static void
+worker_stop(struct cmsg * /* msg */)
+{
+	ev_break(loop(), EVBREAK_ALL);
+}
+
+static void
+main_receive(struct cmsg *m)
+{
+	struct test_msg *msg = (struct test_msg *) m;
+	if (msg->value != main_next++)
+		out_of_order = true;
+	if (main_next == MESSAGES) {
+		cmsg_init(&stop, worker_stop);
+		cpipe_push(&worker_pipe, &stop);
+		cpipe_flush(&worker_pipe);
+		ev_break(loop(), EVBREAK_ALL);
+	}
+}
+
+static void
+main_hello(struct cmsg * /* msg */)
+{
+	for (int i = 0; i < MESSAGES; i++) {
+		cmsg_init(&msgs[i].base, worker_bounce);
+		msgs[i].value = i;
+		cpipe_push(&worker_pipe, &msgs[i].base);
+		if ((i + 1) % BATCH == 0)
+			cpipe_flush(&worker_pipe);
+	}
+	cpipe_flush(&worker_pipe);
+}
+
+static void *
+worker_f(void * /* arg */)
+{
+	cpipe_create(&worker_pipe);
+	/* Let the main cord know the worker pipe is ready. */
+	cmsg_init(&hello, main_hello);
+	cpipe_push(&main_pipe, &hello);
+	cpipe_flush(&main_pipe);
+	ev_run(loop(), 0);
+	cpipe_destroy(&worker_pipe);
+	return NULL;
+}
+
+static void
+cpipe_ping_pong_test()
+{
+	header();
+
+	cpipe_create(&main_pipe);
+	fail_if(cord_start(&worker, "worker", worker_f, NULL) != 0);
+	ev_run(loop(), 0);
+	fail_if(cord_join(&worker) != 0);
+	cpipe_destroy(&main_pipe);
+
+	fail_unless(worker_next == MESSAGES);
+	fail_unless(main_next == MESSAGES);
+	fail_if(out_of_order);
+	note("all messages delivered in order");
+
+	footer();
+}
+
+int main()
+{
+	memory_init();
+	fiber_init();
+	cpipe_ping_pong_test();
+	fiber_free();
+	memory_free();
+	return 0;
+}
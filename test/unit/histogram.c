@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "unit.h"
+#include "histogram.h"
+
+static struct histogram h;
+
+static void
+bucket_check()
+{
+	header();
+	/* Buckets are monotonic and contiguous. */
+	int last = 0;
+	for (int64_t v = 0; v < (1LL << 20); v++) {
+		int b = histogram_bucket(v);
+		fail_unless(b == last || b == last + 1);
+		last = b;
+	}
+	fail_unless(histogram_bucket(-1) == 0);
+	fail_unless(histogram_bucket((1LL << HISTOGRAM_MAX_BITS) - 1) ==
+		    HISTOGRAM_BUCKETS - 1);
+	fail_unless(histogram_bucket(1LL << 50) == HISTOGRAM_BUCKETS - 1);
+	footer();
+}
+
+static void
+percentile_check()
+{
+	header();
+	histogram_reset(&h);
+	fail_unless(histogram_percentile(&h, 50) == 0);
+	for (int64_t v = 1; v <= 1000; v++)
+		histogram_collect(&h, v * 1000);
+	fail_unless(h.count == 1000);
+	fail_unless(h.max == 1000000);
+	fail_unless(h.sum == 500500000);
+	/* The relative error is bounded by the sub-bucket width. */
+	double pcts[] = {1, 10, 50, 90, 99, 99.9};
+	for (size_t i = 0; i < sizeof(pcts) / sizeof(*pcts); i++) {
+		int64_t exact = (int64_t) (pcts[i] * 10 + 1) * 1000;
+		int64_t value = histogram_percentile(&h, pcts[i]);
+		fail_unless(value >= exact);
+		fail_unless(value <= exact + exact / HISTOGRAM_SUB_BUCKETS);
+	}
+	fail_unless(histogram_percentile(&h, 100) == h.max);
+	histogram_reset(&h);
+	fail_unless(h.count == 0 && h.max == 0);
+	footer();
+}
+
+int
+main(void)
+{
+	bucket_check();
+	percentile_check();
+}
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include "unit.h"
 #include "salad/rtree.h"
@@ -277,12 +278,91 @@ neighbor_test()
 	footer();
 }
 
+static void
+bulk_load_test()
+{
+	header();
+
+	const size_t test_count = 10000;
+	const size_t search_count = 100;
+	struct rtree_iterator iterator;
+	rtree_iterator_init(&iterator);
+	struct rtree_rect *arr = new rtree_rect[test_count];
+	struct rtree_bulk_entry *entries = new rtree_bulk_entry[test_count];
+	char *found = new char[test_count];
+
+	for (size_t i = 0; i < test_count; i++) {
+		coord_t x = rand() % 1000, y = rand() % 1000;
+		rtree_set2d(&arr[i], x, y, x + rand() % 10, y + rand() % 10);
+	}
+
+	for (size_t count = 0; count <= test_count;
+	     count = count * 3 + 1) {
+		for (size_t i = 0; i < count; i++) {
+			entries[i].rect = arr[i];
+			entries[i].record = (record_t)(i + 1);
+		}
+		struct rtree tree;
+		rtree_init(&tree, page_alloc, page_free);
+		rtree_bulk_sort(entries, count);
+		rtree_bulk_load(&tree, entries, count);
+		if (rtree_number_of_records(&tree) != count) {
+			fail("Tree count mismatch", "true");
+		}
+
+		for (size_t k = 0; k < search_count; k++) {
+			struct rtree_rect rect;
+			coord_t x = rand() % 1000, y = rand() % 1000;
+			rtree_set2d(&rect, x, y, x + 50, y + 50);
+			memset(found, 0, count);
+			rtree_search(&tree, &rect, SOP_OVERLAPS, &iterator);
+			record_t rec;
+			while ((rec = rtree_iterator_next(&iterator)) != NULL) {
+				size_t i = (size_t)rec - 1;
+				if (i >= count || found[i]) {
+					fail("wrong search result", "true");
+				}
+				found[i] = 1;
+			}
+			for (size_t i = 0; i < count; i++) {
+				struct rtree_rect *r = &arr[i];
+				bool overlaps =
+					r->lower_point.coords[0] <= x + 50 &&
+					r->upper_point.coords[0] >= x &&
+					r->lower_point.coords[1] <= y + 50 &&
+					r->upper_point.coords[1] >= y;
+				if (overlaps != (found[i] != 0)) {
+					fail("search result mismatch", "true");
+				}
+			}
+		}
+
+		/* The tree stays usable after a bulk load */
+		for (size_t i = 0; i < count; i++) {
+			if (!rtree_remove(&tree, &arr[i], (record_t)(i + 1))) {
+				fail("delete element in tree", "false");
+			}
+		}
+		if (rtree_number_of_records(&tree) != 0) {
+			fail("Tree count mismatch", "true");
+		}
+		rtree_destroy(&tree);
+	}
+
+	delete[] found;
+	delete[] entries;
+	delete[] arr;
+	rtree_iterator_destroy(&iterator);
+
+	footer();
+}
 
 int
 main(void)
 {
 	simple_check();
 	neighbor_test();
+	bulk_load_test();
 	if (page_count != 0) {
 		fail("memory leak!", "true");
 	}
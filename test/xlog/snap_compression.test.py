@@ -0,0 +1,65 @@
+import os
+import glob
+import shutil
+from lib.tarantool_server import TarantoolServer
+
+def snap_version(vardir):
+    snaps = sorted(glob.glob(os.path.join(vardir, '*.snap')))
+    f = open(snaps[-1])
+    f.readline()
+    version = f.readline().strip()
+    f.close()
+    return version
+
+print """
+# An uncompressed snapshot.
+"""
+server.stop()
+server.deploy()
+server.admin("space = box.schema.space.create('test')")
+server.admin("index = space:create_index('primary')")
+server.admin("for i = 1, 1000 do space:insert{i, string.rep('x', i % 100)} end")
+server.admin("box.snapshot()")
+print "version:", snap_version(server.vardir)
+server.stop()
+
+print """
+# A server with snap_compression loads an uncompressed snapshot.
+"""
+compressed = TarantoolServer(server.ini)
+compressed.script = 'xlog/compressed.lua'
+compressed.vardir = os.path.join(server.vardir, 'compressed')
+compressed.deploy()
+compressed.stop()
+for f in glob.glob(os.path.join(compressed.vardir, '*.snap')) + \
+         glob.glob(os.path.join(compressed.vardir, '*.xlog')):
+    os.unlink(f)
+for f in glob.glob(os.path.join(server.vardir, '*.snap')) + \
+         glob.glob(os.path.join(server.vardir, '*.xlog')):
+    shutil.copy(f, compressed.vardir)
+compressed.start()
+compressed.admin("box.space.test:len()")
+compressed.admin("t = box.space.test:get{999}")
+compressed.admin("t[1], #t[2]")
+
+print """
+# A compressed snapshot of several blocks survives a restart.
+"""
+compressed.admin("for i = 1001, 2000 do box.space.test:insert{i, string.rep('y', i % 100 * 10)} end")
+compressed.admin("box.space.test:delete{1}")
+compressed.admin("box.snapshot()")
+print "version:", snap_version(compressed.vardir)
+compressed.stop()
+for f in glob.glob(os.path.join(compressed.vardir, '*.xlog')):
+    os.unlink(f)
+compressed.start()
+compressed.admin("box.space.test:len()")
+compressed.admin("box.space.test:get{1}")
+compressed.admin("t = box.space.test:get{2000}")
+compressed.admin("t[1], #t[2]")
+compressed.admin("s = 0 for _, t in box.space.test:pairs() do s = s + t[1] + #t[2] end")
+compressed.admin("s")
+
+compressed.stop()
+compressed.cleanup(True)
+server.start()